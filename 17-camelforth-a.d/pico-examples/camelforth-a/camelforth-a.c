@@ -18,7 +18,14 @@
 
 #define UART_TX_PIN 0
 #define UART_RX_PIN 1
+
+// how long to wait at boot for a USB terminal to open the port;
+// 0 starts the interpreter at once, on the UART
+#ifndef CONSOLE_WAIT_MS
+#define CONSOLE_WAIT_MS 3000
+#endif
 extern void interpreter(void);
+extern void initTermios(void);
 
 char ch;
 void _USB_read_tnr(void) {
@@ -49,14 +56,22 @@ void looper() {
     tryme();
 }
 
+// wait for the USB CDC port to be opened (DTR asserted), or timeout
+void console_wait(void) {
+    absolute_time_t timeout = make_timeout_time_ms(CONSOLE_WAIT_MS);
+    while (!stdio_usb_connected() && !time_reached(timeout)) {
+        sleep_ms(1);
+    }
+}
+
 int main() {
-    sleep_ms(9500);
     uart_init(UART_ID, BAUD_RATE);
 
     gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
     gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
 
     stdio_init_all();
+    initTermios();
 
     uart_putc_raw(UART_ID, 'A');
 
@@ -71,7 +86,7 @@ int main() {
     uart_putc(UART_ID, 'B');
     uart_putc(UART_ID, 'B');
     uart_putc(UART_ID, 'B');
-    sleep_ms(19500);
+    console_wait();
     uart_puts(UART_ID, " Hello, UART!\r\n");
     uart_puts(UART_ID, " project codenamed camelForth-rp2 v0.0.0-b\r\n\r\n\r\n");
     uart_puts(UART_ID, " 8 Feb BUILD env test nice keyboard mirroring UART and USB\r\n");
@@ -12,7 +12,7 @@
  * AUTHOR
  *  Brad Rodriguez
  * TODO
- *  split ROM and RAM space
+ *  split ROM and RAM space (see SPLIT_DICT, for flash code space)
  * HISTORY
  *  12 dec 2017 bjr - released as v0.1
  *  14 feb 2016 bjr - first implementation
@@ -44,8 +44,10 @@
 // #include "pico/stdlib.h"
 
 // original camelforth:
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "forth.h"
 
 /*
@@ -53,20 +55,101 @@
  * stacks grow downward to allow positive index from psp,rsp
  */
 
-unsigned int pstack[PSTACKSIZE];    /* grows down from end */
-unsigned int rstack[RSTACKSIZE];    /* grows down from end */
+/* with STACK_CHECK, spare cells either side of PSTACK and RSTACK
+ * take what a stack that has run over or under writes before the
+ * next check sees it */
+#ifdef STACK_CHECK
+#define STACKPAD STACKGUARD
+#else
+#define STACKPAD 0
+#endif
+unsigned int pstack[PSTACKSIZE + 2*STACKPAD];
+unsigned int rstack[RSTACKSIZE + 2*STACKPAD];
+#define PSTACK (&pstack[STACKPAD])      /* grows down from end */
+#define RSTACK (&rstack[STACKPAD])      /* grows down from end */
+unsigned int lstack[LSTACKSIZE];    /* grows up from start */
+#define STACKFILL 0x55555555        /* stack cells never used, for .MEM */
+unsigned int uservars[USERSIZE];
+
+#ifdef MULTICORE
+#ifndef MULTITASK
+#error "MULTICORE requires MULTITASK"
+#endif
+/* each core runs its own tasks, with its own interpreter registers */
+#ifdef RP2040_PICO
+struct Context cpuctx[2];
+/* the SIO CPUID register.  A function runs on one core throughout,
+ * so the asm is not volatile: the compiler may read it once in each
+ * function, and out of the inner interpreter's loop, rather than at
+ * every use of psp, rsp or ip */
+static inline unsigned int cpuid(void) {
+    unsigned int id;
+    __asm ("ldr %0, [%1]" : "=l" (id) : "l" (0xd0000000));
+    return id;
+}
+#define CPU cpuctx[cpuid()]
+#else
+__thread struct Context cpuctx;     /* one for each host thread */
+#define CPU cpuctx
+#endif
+#define psp     CPU.psp
+#define rsp     CPU.rsp
+#define ip      CPU.ip
+#define run     CPU.run
+#define up      CPU.up
+#define curtask CPU.task
+#define stacklim CPU.limit
+#else
 unsigned int *psp, *rsp;            /* stack pointers */
 void *ip;                           /* interpreter pointer */
 bool run;                           /* "run" flag */
+#ifdef MULTITASK
+unsigned int *up = uservars;        /* user area of the running task */
+struct Task *curtask;               /* the running task */
+#else
+#define up uservars
+#endif
+#ifdef STACK_CHECK
+struct StackLimit stacklim;         /* of the running task */
+#endif
+#endif
 
-unsigned int lstack[LSTACKSIZE];    /* grows down from end */
-unsigned int uservars[USERSIZE];
+#ifdef STACK_CHECK
+/* true if a parameter or return stack pointer is out of bounds */
+#define STACKBAD(sp, rp) \
+    (((unsigned int)(sp) - (unsigned int)stacklim.plow > stacklim.pspan) \
+    || ((unsigned int)(rp) - (unsigned int)stacklim.rlow > stacklim.rspan))
+static void stackfail(const void *where);
+/* if c, check the stacks: at a call, or a branch back, since a
+ * recursion or a loop may run a stack out before any EXIT */
+#define STACKCHECK(c) if ((c) && STACKBAD(psp, rsp)) stackfail(ip)
+
+/* the bounds of stacks of pn, rn and ln cells, at ps, rs and ls */
+static void stacklimit(struct StackLimit *l, unsigned int *ps,
+                unsigned int pn, unsigned int *rs, unsigned int rn,
+                unsigned int *ls, unsigned int ln) {
+    l->plow = ps;
+    l->pspan = (pn - 1) * CELL;
+    l->rlow = rs;
+    l->rspan = (rn - 1) * CELL;
+    l->llow = ls;
+    l->lspan = (ln - 1) * CELL;
+}
+#else
+#define STACKCHECK(c)
+#endif
 unsigned char tibarea[TIBSIZE];
 unsigned char padarea[PADSIZE];
 unsigned char holdarea[HOLDSIZE];
 
+/* dictionary and data space; HERE stops WORDROOM bytes short of the
+ * end, leaving room for the counted string WORD puts at HERE */
+unsigned char RAMDICT[DICTSIZE];
+#define WORDROOM  258
+#define DICTLIMIT (RAMDICT + DICTSIZE - WORDROOM)
+unsigned char *dicthigh = RAMDICT;  /* highest HERE since reset */
+
 /* STUBS TBD */
-unsigned char RAMDICT[8192];
 unsigned char ROMDICT[1024];
 
 #ifdef LINUX
@@ -104,12 +187,13 @@ void Fdorom (void * pfa) {
 void Fenter (void * pfa) {
     *--rsp = (unsigned int)ip;      /* push old IP on return stack */
     ip = pfa;                       /* IP points to thread */
+    STACKCHECK(1);
 }
 
 void Fdouser (void * pfa) {
     unsigned int i;
     i = *(unsigned int *)pfa;               /* pf holds user var index */
-    *--psp = (unsigned int)(&uservars[i]);  /* stack adrs of user var */
+    *--psp = (unsigned int)(&up[i]);        /* stack adrs of user var */
 }
 
 /* CREATE to support FIG-Forth style DOES>
@@ -118,10 +202,16 @@ void Fdouser (void * pfa) {
  * Defined (child) word is originally [Fdocreate] [don'tcare] [...data...]
  * which returns the address of 'data' (CFA + 2 cells).
  * DOES> will change child word to    [Fdobuilds] [Tdoesword] [...data...]
+ * With SPLIT_DICT the data is in RAM, and [...data...] is one cell
+ * holding its address.
  */
 
 void Fdocreate (void * pfa) {
+#ifdef SPLIT_DICT
+    *--psp = *(unsigned int *)(pfa + CELL);
+#else
     *--psp = (unsigned int)pfa + CELL;
+#endif
 }
 
 
@@ -136,7 +226,11 @@ void Fdobuilds (void * pfa) {
 
         w = *(void **)pfa;      /* fetch word address from param field */
         pfa += CELL;
+#ifdef SPLIT_DICT
+        *--psp = *(unsigned int *)pfa;  /* push address of data in RAM */
+#else
         *--psp = (unsigned int)pfa; /* push address of following data */
+#endif
             
         x = *(void **)w;        /* fetch function adrs from word def */
         xt = (void (*)())x;     /* too much casting! */
@@ -149,6 +243,12 @@ void Fdobuilds (void * pfa) {
  */
 
 CODE(exit) {
+#ifdef STACK_CHECK
+    if (STACKBAD(psp, rsp)) {
+        stackfail(ip - CELL);
+        return;
+    }
+#endif
     ip = (void *)(*rsp++);        /* pop IP from return stack */
 }
 
@@ -212,6 +312,12 @@ CODE(nip) {     // x1 x2 -- x2
     psp++;
 }
 
+CODE(twodup) {  // x1 x2 -- x1 x2 x1 x2
+    psp -= 2;
+    psp[0] = psp[2];
+    psp[1] = psp[3];
+}
+
 CODE(tuck) {    // x1 x2 -- x2 x1 x2
     unsigned int x;
     --psp;
@@ -312,12 +418,14 @@ CODE(mult) {
     psp[0] = (unsigned int)r;
 }
 
+#ifndef NATIVE_DIVIDE     /* else in divide.inc */
 CODE(div) {
     signed int r;
     r = (signed int)psp[1] / (signed int)psp[0];
     psp++;
     psp[0] = (unsigned int)r;
 }
+#endif
 
 CODE(and) {
     psp[1] &= psp[0];
@@ -424,6 +532,7 @@ CODE(branch) {     /* Tbranch,-4  loops back to itself */
     int offset;                 /* Tbranch,+4  is a no-op */
     offset = *(unsigned int*)ip;     /* fetch inline offset */
     ip += offset;
+    STACKCHECK(offset < 0);
 }
 
 CODE(qbranch) {    /* Tbranch,-4  loops back to itself */
@@ -431,6 +540,7 @@ CODE(qbranch) {    /* Tbranch,-4  loops back to itself */
     if (*psp++ == 0) {
         offset = *(unsigned int*)ip;     /* fetch inline offset */
         ip += offset;
+        STACKCHECK(offset < 0);
     } else {
         ip += CELL;
     }
@@ -458,6 +568,7 @@ CODE(xplusloop) {   /* n -- */
     } else {                            
         offset = *(unsigned int*)ip;        // no: branch 
         ip += offset;
+        STACKCHECK(1);
     }
 }        
 
@@ -470,6 +581,7 @@ CODE(xloop) {
     } else {                            
         offset = *(unsigned int*)ip;        // no: branch 
         ip += offset;
+        STACKCHECK(1);
     }
 }        
 
@@ -500,6 +612,9 @@ CODE(umstar) {  /* u1 u2 -- ud */
     psp[0] = ud >> 32;
 }    
     
+#ifdef NATIVE_DIVIDE
+#include "divide.inc"
+#else
 CODE(umslashmod) {  /* ud u1 -- rem quot */
     uint64_t ud, u1;
     u1 = *psp++;
@@ -507,16 +622,27 @@ CODE(umslashmod) {  /* ud u1 -- rem quot */
     psp[1] = (unsigned int)(ud % u1);
     psp[0] = (unsigned int)(ud / u1);
 }
+#endif
  
 /* BLOCK AND STRING OPERATIONS */
 
+/* Block moves go through the library memmove (word at a time when
+ * alignment permits), or the platform's dmamove() with DMA_MOVE.
+ * CMOVE and CMOVE> copy a byte at a time only when the regions
+ * overlap so that the copy propagates, e.g. "1 CMOVE" to fill. */
+#ifdef DMA_MOVE
+#define MOVEBYTES(dst,src,u)  dmamove(dst,src,u)
+#else
+#define MOVEBYTES(dst,src,u)  memmove(dst,src,u)
+#endif
+
 CODE(fill) {    /* c-addr u char -- */
     unsigned char c, *dst;
     unsigned int u;
     c = (unsigned char)*psp++;
     u = *psp++;
     dst = (unsigned char *)*psp++;
-    while (u-- > 0) *dst++ = c;
+    memset(dst, c, u);
 }
 
 CODE(cmove) {   /* src dst u -- */
@@ -525,16 +651,35 @@ CODE(cmove) {   /* src dst u -- */
     u = *psp++;
     dst = (unsigned char *)*psp++;
     src = (unsigned char *)*psp++;
-    while (u-- > 0) *dst++ = *src++;
+    if ((dst <= src) || (dst >= src + u)) {
+        MOVEBYTES(dst, src, u);
+    } else {
+        while (u-- > 0) *dst++ = *src++;
+    }
 }
 
 CODE(cmoveup) {   /* src dst u -- */
     unsigned char *dst, *src;
     unsigned int u;
     u = *psp++;
-    dst = (unsigned char *)(u + *psp++);
-    src = (unsigned char *)(u + *psp++);
-    while (u-- > 0) *--dst = *--src;
+    dst = (unsigned char *)*psp++;
+    src = (unsigned char *)*psp++;
+    if ((dst >= src) || (dst + u <= src)) {
+        MOVEBYTES(dst, src, u);
+    } else {
+        dst += u;
+        src += u;
+        while (u-- > 0) *--dst = *--src;
+    }
+}
+
+CODE(move) {    /* src dst u -- */
+    unsigned char *dst, *src;
+    unsigned int u;
+    u = *psp++;
+    dst = (unsigned char *)*psp++;
+    src = (unsigned char *)*psp++;
+    MOVEBYTES(dst, src, u);
 }
 
 CODE(skip) {    /* c-addr u c -- c-addr' u' */
@@ -582,7 +727,18 @@ CODE(sequal) {  /* c-addr1 c-addr2 u -- n */
 
 /* TERMINAL I/O */
 
+#ifdef NATIVE_ACCEPT
+#include "accept.inc"
+#endif
+
 CODE(key) {
+#ifdef NATIVE_ACCEPT
+    if (keytail != keyhead) {       /* left over from ACCEPT */
+        keycr = 0;
+        *--psp = keybuf[keytail++];
+        return;
+    }
+#endif
     *--psp = (unsigned int)getch();
 }
 
@@ -591,13 +747,39 @@ CODE(emit) {
 }
 
 CODE(keyq) {
+#ifdef NATIVE_ACCEPT
+    if (keytail != keyhead) {
+        *--psp = -1;
+        return;
+    }
+#endif
     *--psp = getquery(); 
 }
 
-CODE(dot) {        /* temporary definition for testing */
-    printf(" %d", *psp++);
+#if defined(LOAD_STREAM) || defined(LOAD_IMAGE)
+/* read waiting input, at least one character, at most max */
+static unsigned int getbulk(unsigned char *buf, unsigned int max) {
+#ifdef NATIVE_ACCEPT
+    unsigned int n = 0;
+    while ((keytail != keyhead) && (n < max)) buf[n++] = keybuf[keytail++];
+    if (n > 0) return n;
+#endif
+    return getchars(buf, max);
+}
+#endif
+
+#ifdef TX_BUFFER
+CODE(type) {    /* c-addr u -- */
+    unsigned int n;
+    n = *psp++;
+    putchars((const char *)*psp++, n);
 }
 
+CODE(flush) {   /* -- */
+    flushout();
+}
+#endif
+
 CODE(dothh) {        /* temporary definition for testing */
     printf(" %2x", *psp++);
 }
@@ -608,7 +790,7 @@ CODE(dothhhh) {        /* temporary definition for testing */
 
 CODE(dots) {    /* print stack, for testing */
     unsigned int *p;
-    p = &pstack[PSTACKSIZE-2];      /* deepest element on stack */
+    p = &PSTACK[PSTACKSIZE-2];      /* deepest element on stack */
     putchar(' ');
     putchar('D');
     putchar('e');
@@ -622,13 +804,18 @@ CODE(dots) {    /* print stack, for testing */
 }
 
 CODE(dump) {   /* adr n -- */
+    static const char hex[] = "0123456789abcdef";
+    char line[12 + 16*3];       /* one line, written in one go */
     unsigned char *p;
-    unsigned int n, i;
+    unsigned int n, i, k = 0;
     n = *psp++;
     p = (unsigned char *)*psp++;
     for (i=0; i<n; i++) {
-        if ((i&0xf)==0) printf("\n%8x:", (unsigned int)p);
-        printf(" %02x", *p++);
+        if ((i&0xf)==0) k = snprintf(line, 12, "\n%8x:", (unsigned int)p);
+        line[k++] = ' ';
+        line[k++] = hex[*p >> 4];
+        line[k++] = hex[*p++ & 0xf];
+        if (((i&0xf)==0xf) || (i==n-1)) putchars(line, k);
     }
 }       
 
@@ -636,6 +823,16 @@ CODE(bye) {
     run = 0;
 }
 
+#ifdef RP2040_PICO
+CODE(bootus) {  /* -- u   microseconds from reset to first input */
+    *--psp = bootus;
+}
+#endif
+
+#ifdef MULTITASK
+#include "tasks.inc"
+#endif
+
 /*
  * HIGH LEVEL WORD DEFINITIONS
  */
@@ -663,11 +860,13 @@ PRIMITIVE(store);
 PRIMITIVE(cfetch);
 PRIMITIVE(cstore);
 
+#ifndef SPLIT_DICT
 /* synonyms for unified code and data space */
 #define Tifetch  Tfetch
 #define Ticfetch Tcfetch
 #define Tistore  Tstore
 #define Ticstore Tcstore
+#endif
 #define Thfetch  Tfetch
 #define Thcfetch Tcfetch
 #define Thstore  Tstore
@@ -721,15 +920,26 @@ PRIMITIVE(scan);
 PRIMITIVE(sequal);
 THREAD(nequal) = { Fsequal };  /* synonym */
     
+#ifdef MULTITASK
+extern const void * Tkeyq[];    /* forward reference */
+PRIMITIVE(pause);
+THREAD(xkey) = { Fkey };
+THREAD(key) = { Fenter,         /* let other tasks run while waiting */
+ /*1*/  Tpause, Tkeyq, Tqbranch, OFFSET(-3 /*1*/),
+        Txkey, Texit };
+#else
 PRIMITIVE(key);
+#endif
 PRIMITIVE(emit);
 PRIMITIVE(keyq);
-// PRIMITIVE(dot);
 PRIMITIVE(dothh);
 PRIMITIVE(dothhhh);
 PRIMITIVE(dots);
 PRIMITIVE(dump);
 PRIMITIVE(bye);
+#ifdef RP2040_PICO
+PRIMITIVE(bootus);
+#endif
 
 /* USER VARIABLES */
 
@@ -742,26 +952,192 @@ THREAD(ticksource) = { Fdouser, LIT(5) };    /* two cells */
 THREAD(latest) = { Fdouser, LIT(7) };
 THREAD(hp) = { Fdouser, LIT(8) };
 THREAD(lp) = { Fdouser, LIT(9) };
+#ifdef SPLIT_DICT
+THREAD(idp) = { Fdouser, LIT(10) };
+#else
 // THREAD(idp) = { Fdouser, LIT(10) };          /* not used in this model */
+#endif
 THREAD(newest) = { Fdouser, LIT(11) };
 
+/* the same user variables, as seen from C */
+#define Utoin       up[1]
+#define Ubase       up[2]
+#define Ustate      up[3]
+#define Udp         up[4]
+#define Usourcelen  up[5]
+#define Usourceadr  up[6]
+#define Ulatest     up[7]
+#define Uhp         up[8]
+#define Ulp         up[9]
+#ifdef SPLIT_DICT
+#define Uidp        up[10]
+#else
+#define Uidp        Udp     /* code space is the dictionary */
+#endif
+#define Unewest     up[11]
+
+/* DICTIONARY SPACE, checked */
+
+extern const void *Tdictfull[];
+
+/* true if HERE may move by n bytes; if not, the next word run is
+ * ABORT with a message */
+static bool dictroom(int n) {
+    unsigned char *p = (unsigned char *)Udp + n;
+    if ((p > DICTLIMIT) || (p < RAMDICT)) {
+        ip = (void *)Tdictfull;
+        return 0;
+    }
+    if (p > dicthigh) dicthigh = p;
+    return 1;
+}
+
+CODE(allot) {   /* n -- */
+    int n = *psp++;
+    if (dictroom(n)) Udp += n;
+}
+
+CODE(comma) {   /* x -- */
+    unsigned int x = *psp++;
+    if (dictroom(CELL)) {
+        *(unsigned int *)Udp = x;
+        Udp += CELL;
+    }
+}
+
+CODE(ccomma) {  /* char -- */
+    unsigned char c = *psp++;
+    if (dictroom(1)) {
+        *(unsigned char *)Udp = c;
+        Udp += 1;
+    }
+}
+
+CODE(unused) {  /* -- u   bytes left in the dictionary */
+    *--psp = DICTLIMIT - (unsigned char *)Udp;
+}
+
+#ifdef SPLIT_DICT
+#ifndef CODESPACE
+#error "SPLIT_DICT needs a code space in flash from the platform"
+#endif
+#include "splitdict.inc"
+PRIMITIVE(iallot);
+PRIMITIVE(icomma);
+PRIMITIVE(iccomma);
+PRIMITIVE(ifetch);
+PRIMITIVE(icfetch);
+PRIMITIVE(istore);
+PRIMITIVE(icstore);
+PRIMITIVE(istring);
+PRIMITIVE(iflush);
+PRIMITIVE(iexecute);
+#else
+/* the code space, as seen from C, is the dictionary */
+#define idictroom   dictroom
+#define ifetch(a)   (*(const unsigned int *)(a))
+#define istore(a,x) (*(unsigned int *)(a) = (x))
+#define iflush()    1
+#define Tiexecute   Texecute
+#endif
+
+#ifdef STACK_CHECK
+#include "stackcheck.inc"
+PRIMITIVE(checkexecute);
+#else
+#define Tcheckexecute Tiexecute
+#endif
+
+#ifdef PEEPHOLE
+#include "peephole.inc"
+PRIMITIVE(litplus);
+PRIMITIVE(fetchplus);
+PRIMITIVE(zeroqbranch);
+THREAD(optimize) = { Fdocon, (void *)&optimize };
+#endif
+
+#ifdef NATIVE_COMPILE
+#include "native.inc"
+PRIMITIVE(compilenative);
+PRIMITIVE(unnative);
+THREAD(nativeon) = { Fdocon, (void *)&nativeon };
+#endif
+
+#ifdef PROFILE
+#include "profile.inc"
+PRIMITIVE(profileon);
+PRIMITIVE(profileoff);
+PRIMITIVE(dotprofile);
+#endif
+
+#ifdef SAVE_SYSTEM
+#include "save.inc"
+PRIMITIVE(savesystem);
+PRIMITIVE(turnkey);
+PRIMITIVE(unsave);
+PRIMITIVE(loadimage);
+#endif
+
+/* deepest use of a stack of n cells, filled with STACKFILL at reset */
+static unsigned int stackhigh(const unsigned int *stack, unsigned int n) {
+    unsigned int i;
+    for (i = 0; (i < n - 1) && (stack[i] == STACKFILL); i++);
+    return n - 1 - i;
+}
+
+CODE(dotmem) {  /* --   memory use by region */
+    printf("\n%-14s %8s %8s %8s %8s", "", "used", "free", "size", "high");
+    printf("\n%-14s %8u %8u %8u %8u", "dictionary",
+            (unsigned int)((unsigned char *)Udp - RAMDICT),
+            (unsigned int)(DICTLIMIT - (unsigned char *)Udp),
+            (unsigned int)(DICTLIMIT - RAMDICT),
+            (unsigned int)(dicthigh - RAMDICT));
+    printf("\n%-14s %8u %8u %8u %8u", "data stack",
+            (unsigned int)(&PSTACK[PSTACKSIZE-1] - psp),
+            (unsigned int)(psp - PSTACK), PSTACKSIZE-1,
+            stackhigh(PSTACK, PSTACKSIZE));
+    printf("\n%-14s %8u %8u %8u %8u", "return stack",
+            (unsigned int)(&RSTACK[RSTACKSIZE-1] - rsp),
+            (unsigned int)(rsp - RSTACK), RSTACKSIZE-1,
+            stackhigh(RSTACK, RSTACKSIZE));
+#ifdef SPLIT_DICT
+    printf("\n%-14s %8u %8u %8u %8u", "code space",
+            (unsigned int)((unsigned char *)Uidp - CODESPACE),
+            (unsigned int)(CODESPACE + CODESIZE - (unsigned char *)Uidp),
+            CODESIZE, (unsigned int)(ihigh - CODESPACE));
+#endif
+#ifdef NATIVE_COMPILE
+    printf("\n%-14s %8u %8u %8u %8u", "native code",
+            (unsigned int)(NATIVESIZE - (nativeveneer - nativehere)),
+            (unsigned int)(nativeveneer - nativehere), NATIVESIZE,
+            nativehigh);
+#endif
+}
+
 extern const struct Header Hcold;
 
 THREAD(uinit) = { Fdorom, 
     LIT(0),  LIT(0),  LIT(10), LIT(0),  // u0 >in base state
     RAMDICT, LIT(0),  LIT(0),  Hcold.nfa,    // dp source latest
-    LIT(0),  LIT(0),  ROMDICT, LIT(0) };  // hp lp idp newest
+#ifdef SPLIT_DICT
+    LIT(0),  lstack,  CODESPACE, LIT(0) };  // hp lp idp newest
+#else
+    LIT(0),  lstack,  ROMDICT, LIT(0) };  // hp lp idp newest
+#endif
 THREAD(ninit) = { Fdocon, LIT(16*CELL) };
 
 /* CONSTANTS and some system variables */
 
 THREAD(pad) = { Fdocon, padarea };
-THREAD(l0) = { Fdocon, &lstack[LSTACKSIZE-1] };
-THREAD(s0) = { Fdocon, &pstack[PSTACKSIZE-1] };
-THREAD(r0) = { Fdocon, &rstack[RSTACKSIZE-1] };
+THREAD(l0) = { Fdocon, &lstack[0] };
+THREAD(s0) = { Fdocon, &PSTACK[PSTACKSIZE-1] };
+THREAD(r0) = { Fdocon, &RSTACK[RSTACKSIZE-1] };
 THREAD(tib) = { Fdocon, tibarea };
 THREAD(tibsize) = { Fdocon, LIT(TIBSIZE) };
 THREAD(bl) = { Fdocon, LIT(0x20) };
+#ifdef RX_BUFFER
+THREAD(rxlost) = { Fdocon, (void *)&rxlost };  /* input chars dropped */
+#endif
 
 THREAD(zero) = { Fdocon, LIT(0) };
 THREAD(one) = { Fdocon, LIT(1) };
@@ -780,16 +1156,22 @@ THREAD(chars) = { Fenter, Texit };   /* no operation */
 /* DICTIONARY MANAGEMENT */
 
 THREAD(here) = { Fenter, Tdp, Tfetch, Texit };
-THREAD(allot) = { Fenter, Tdp, Tplusstore, Texit };
-THREAD(comma) = { Fenter, There, Tstore, Tcell, Tallot, Texit };
-THREAD(ccomma) = { Fenter, There, Tcstore, Tone, Tchars, Tallot, Texit };
-
+PRIMITIVE(allot);
+PRIMITIVE(comma);
+PRIMITIVE(ccomma);
+PRIMITIVE(unused);
+PRIMITIVE(dotmem);
+
+#ifdef SPLIT_DICT
+THREAD(ihere) = { Fenter, Tidp, Tfetch, Texit };
+#else
 /* synonyms for unified code and data space */
 #define Tidp     Tdp
 #define Tihere   There
 #define Tiallot  Tallot
 #define Ticomma  Tcomma
 #define Ticcomma Tccomma
+#endif
 /* synonyms for unified header and data space */
 #define Thhere   There
 #define Thallot  Tallot
@@ -802,28 +1184,49 @@ THREAD(ccomma) = { Fenter, There, Tcstore, Tone, Tchars, Tallot, Texit };
     /* cell alignment */
 THREAD(aligned) = { Fenter, Tcell, Tover, Tminus, Tcell, Toneminus, Tand,
                 Tplus, Texit };
+#ifdef SPLIT_DICT
+THREAD(align) = { Fenter, Tihere, Taligned, Tidp, Tstore,
+                There, Taligned, Tdp, Tstore, Texit };    /* both spaces */
+#else
 THREAD(align) = { Fenter, Tihere, Taligned, Tidp, Tstore, Texit };
+#endif
 THREAD(cellplus) = { Fenter, Tcell, Tplus, Texit };
 THREAD(charplus) = { Fenter, Tone, Tplus, Texit };
 
 /* >BODY is entered with CFA on stack.  For most words, body is
  * CFA + 1 cell.  For words built with CREATE or CREATE..DOES> ,
- * body is CFA + 2 cells. */
+ * body is CFA + 2 cells (with SPLIT_DICT, the RAM address there). */
+#ifdef SPLIT_DICT
+THREAD(tobody) = { Fenter, 
+    Tdup, Tifetch,                      /* fetch code field */
+    Tdup, Tlit, Fdocreate, Tequal,      /* if it's Fdocreate */
+    Tswap, Tlit, Fdobuilds, Tequal, Tor,  /* or Fdobuilds */
+    Tqbranch, OFFSET(5),                /* then fetch the data address */
+    Tcellplus, Tcellplus, Tifetch, Texit,
+    Tcell, Tplus, Texit };
+#else
 THREAD(tobody) = { Fenter, 
     Tdup, Tifetch,                      /* fetch code field */
     Tdup, Tlit, Fdocreate, Tequal,      /* if it's Fdocreate */
     Tswap, Tlit, Fdobuilds, Tequal, Tor,  /* or Fdobuilds */
     Tqbranch, OFFSET(3), Tcell, Tplus,  /* then add an extra cell */
     Tcell, Tplus, Texit };
+#endif
 
+#ifdef PEEPHOLE
+PRIMITIVE(commaxt);
+PRIMITIVE(ilabel);
+#else
 THREAD(commaxt) = { Fenter, Ticomma, Texit };
+#define Tilabel Tihere      /* HERE as a branch destination */
+#endif
 THREAD(storecf) = { Fenter, Tistore, Texit };
 THREAD(commacf) = { Fenter, Tihere, Tstorecf, Tcell, Tiallot, Texit };
 THREAD(commaexit) = { Fenter, Tlit, Texit, Tcommaxt, Texit };
 
     /* the c model uses relative addressing from the location of the 
      * offset cell */
-THREAD(commabranch) = { Fenter, Ticomma, Texit };
+THREAD(commabranch) = { Fenter, Tcommaxt, Texit };
 THREAD(commadest) = { Fenter, Tihere, Tminus, Ticomma, Texit };
 THREAD(storedest) = { Fenter, Ttuck, Tminus, Tswap, Tistore, Texit };
 THREAD(commanone) = { Fenter, Tcell, Tiallot, Texit };
@@ -833,7 +1236,7 @@ THREAD(commanone) = { Fenter, Tcell, Tiallot, Texit };
 THREAD(twofetch) = { Fenter, Tdup, Tcellplus, Tfetch, Tswap, Tfetch, Texit };
 THREAD(twostore) = { Fenter, Tswap, Tover, Tstore, Tcellplus, Tstore, Texit };
 THREAD(twodrop) = { Fenter, Tdrop, Tdrop, Texit };
-THREAD(twodup) = { Fenter, Tover, Tover, Texit };
+PRIMITIVE(twodup);
 THREAD(twoswap) = { Fenter, Trot, Ttor, Trot, Trfrom, Texit };
 THREAD(twoover) = { Fenter, Ttor, Ttor, Ttwodup, Trfrom, Trfrom,
                     Ttwoswap, Texit };
@@ -853,6 +1256,10 @@ THREAD(dabs) = { Fenter, Tdup, Tqdnegate, Texit };
 THREAD(mstar) = { Fenter, Ttwodup, Txor, Ttor,
                     Tswap, Tabs, Tswap, Tabs, Tumstar,
                     Trfrom, Tqdnegate, Texit }; 
+#ifdef NATIVE_DIVIDE
+PRIMITIVE(smslashrem);
+PRIMITIVE(fmslashmod);
+#else
 THREAD(smslashrem) = { Fenter, Ttwodup, Txor, Ttor, Tover, Ttor,
                     Tabs, Ttor, Tdabs, Trfrom, Tumslashmod, Tswap,
                     Trfrom, Tqnegate, Tswap, Trfrom, Tqnegate, Texit };
@@ -863,12 +1270,21 @@ THREAD(fmslashmod) = { Fenter, Tdup, Ttor, Ttwodup, Txor, Ttor, Ttor,
                     Tnegate, Tover, Tqbranch, OFFSET(6),
                     Trfetch, Trot, Tminus, Tswap, Toneminus,
                     /* branch dest */ Trfrom, Tdrop, Texit };
+#endif
 THREAD(star) = { Fenter, Tmstar, Tdrop, Texit };
+#ifdef NATIVE_DIVIDE
+PRIMITIVE(slashmod);
+PRIMITIVE(slash);
+PRIMITIVE(mod);
+PRIMITIVE(starslashmod);
+PRIMITIVE(starslash);
+#else
 THREAD(slashmod) = { Fenter, Ttor, Tstod, Trfrom, Tfmslashmod, Texit };
 THREAD(slash) = { Fenter, Tslashmod, Tnip, Texit };
 THREAD(mod) = { Fenter, Tslashmod, Tdrop, Texit };
 THREAD(starslashmod) = { Fenter, Ttor, Tmstar, Trfrom, Tfmslashmod, Texit };
 THREAD(starslash) = { Fenter, Tstarslashmod, Tnip, Texit };
+#endif
 THREAD(max) = { Fenter, Ttwodup, Tless, Tqbranch, OFFSET(2), Tswap,
                 Tdrop, Texit };
 THREAD(min) = { Fenter, Ttwodup, Tgreater, Tqbranch, OFFSET(2), Tswap,
@@ -881,8 +1297,13 @@ THREAD(umin) = { Fenter, Ttwodup, Tugreater, Tqbranch, OFFSET(2), Tswap,
 /* CPU DEPENDENCIES CONT'D. */
 
 THREAD(cells) = { Fenter, Tcell, Tstar, Texit };
+#ifdef SPLIT_DICT
+THREAD(storecolon) = { Fenter, Tthree, Tcells, Tnegate, Tiallot, 
+                      Tlit, Fenter, Tcommacf, Texit };
+#else
 THREAD(storecolon) = { Fenter, Ttwo, Tcells, Tnegate, Tiallot, 
                       Tlit, Fenter, Tcommacf, Texit };
+#endif
 
 /* INPUT/OUTPUT */
 
@@ -893,6 +1314,20 @@ THREAD(space) = { Fenter, Tlit, LIT(0x20), Temit, Texit };
 THREAD(spaces) = { Fenter, Tdup, Tqbranch, OFFSET(5), Tspace, Toneminus,
                 Tbranch, OFFSET(-6), Tdrop, Texit };
 
+#ifdef NATIVE_ACCEPT
+PRIMITIVE(xaccept);
+THREAD(echo) = { Fdocon, (void *)&echo };
+#ifdef MULTITASK
+THREAD(accept) = { Fenter, Tzero,
+/* 1 */  Tpause, Tkeyq, Tqbranch, OFFSET(-3 /*1*/),
+         Txaccept, Tqbranch, OFFSET(-6 /*1*/),
+         Tnip, Tnip, Texit };
+#else
+THREAD(accept) = { Fenter, Tzero,
+/* 1 */  Txaccept, Tqbranch, OFFSET(-2 /*1*/),
+         Tnip, Tnip, Texit };
+#endif
+#else
 #ifdef LINUX
 #define NEWLINE 0x0a
 #define BACKSPACE 0x7f      /* key returned for backspace */
@@ -911,13 +1346,19 @@ THREAD(accept) = { Fenter, Tover, Tplus, Toneminus, Tover,
 /* 3 */  Tdup, Temit, Tover, Tcstore, Toneplus, Tover, Tumin,
 /* 4 */  Tbranch, OFFSET(-32 /*1*/),
 /* 5 */  Tdrop, Tnip, Tswap, Tminus, Texit };
+#endif
 
+#ifdef TX_BUFFER
+PRIMITIVE(type);
+PRIMITIVE(flush);
+#else
 THREAD(type) = { Fenter, Tqdup, Tqbranch, OFFSET(12 /*4*/),
          Tover, Tplus, Tswap, Txdo,
 /* 3 */  Ti, Tcfetch, Temit, Txloop, OFFSET(-4 /*3*/),
          Tbranch,  OFFSET(2 /*5*/),
 /* 4 */  Tdrop,
 /* 5 */  Texit };
+#endif
 
 #define Ticount Tcount
 #define Titype Ttype
@@ -929,11 +1370,24 @@ THREAD(udslashmod) = { Fenter, Ttor, Tzero, Trfetch, Tumslashmod, Trot, Trot,
 THREAD(udstar) = { Fenter, Tdup, Ttor, Tumstar, Tdrop,
          Tswap, Trfrom, Tumstar, Trot, Tplus, Texit };
          
+THREAD(todigit) = { Fenter, Tdup, Tlit, LIT(9), Tgreater, Tlit, LIT(7),
+                Tand, Tplus, Tlit, LIT(0x30), Tplus, Texit };
+#ifdef NATIVE_NUMBERS
+#include "numout.inc"
+PRIMITIVE(hold);
+PRIMITIVE(lessnum);
+PRIMITIVE(num);
+PRIMITIVE(nums);
+PRIMITIVE(numgreater);
+PRIMITIVE(sign);
+PRIMITIVE(udot);
+PRIMITIVE(dot);
+PRIMITIVE(udotr);
+PRIMITIVE(dotr);
+#else
 THREAD(hold) = { Fenter, Tminusone, Thp, Tplusstore,
                 Thp, Tfetch, Tcstore, Texit };
 THREAD(lessnum) = { Fenter, Tlit, &holdarea[HOLDSIZE-1], Thp, Tstore, Texit };
-THREAD(todigit) = { Fenter, Tdup, Tlit, LIT(9), Tgreater, Tlit, LIT(7),
-                Tand, Tplus, Tlit, LIT(0x30), Tplus, Texit };
 THREAD(num) = { Fenter, Tbase, Tfetch, Tudslashmod, Trot, Ttodigit,
                 Thold, Texit };
 THREAD(nums) = { Fenter, Tnum, Ttwodup, Tor, Tzeroequal, Tqbranch, OFFSET(-5),
@@ -946,6 +1400,12 @@ THREAD(udot) = { Fenter, Tlessnum, Tzero, Tnums, Tnumgreater, Ttype,
                 Tspace, Texit };
 THREAD(dot) = { Fenter, Tlessnum, Tdup, Tabs, Tzero, Tnums, Trot, Tsign,
                 Tnumgreater, Ttype, Tspace, Texit };
+THREAD(udotr) = { Fenter, Ttor, Tlessnum, Tzero, Tnums, Tnumgreater,
+                Trfrom, Tover, Tminus, Tzero, Tmax, Tspaces, Ttype, Texit };
+THREAD(dotr) = { Fenter, Ttor, Tlessnum, Tdup, Tabs, Tzero, Tnums, Trot,
+                Tsign, Tnumgreater,
+                Trfrom, Tover, Tminus, Tzero, Tmax, Tspaces, Ttype, Texit };
+#endif
 THREAD(decimal) = { Fenter, Tlit, LIT(10), Tbase, Tstore, Texit };
 THREAD(hex) = { Fenter, Tlit, LIT(16), Tbase, Tstore, Texit };
 
@@ -958,20 +1418,31 @@ THREAD(tocounted) = { Fenter, Ttwodup, Tcstore, Tcharplus, Tswap, Tcmove,
                         Texit };
 THREAD(adrtoin) = { Fenter, Tsource, Trot, Trot, Tminus, Tmin, Tzero, Tmax,
                     Ttoin, Tstore, Texit };
+#ifdef NATIVE_INTERPRET
+#include "interpret.inc"
+PRIMITIVE(parse);
+PRIMITIVE(word);
+#else
 THREAD(parse) = { Fenter, Tsource, Ttoin, Tfetch, Tslashstring,   
         Tover, Ttor, Trot, Tscan, Tover, Tswap, Tqbranch, OFFSET(2),
         Tcharplus, Tadrtoin, Trfrom, Ttuck, Tminus, Texit };
 THREAD(word) = { Fenter, Tdup, Tsource, Ttoin, Tfetch, Tslashstring,
         Trot, Tskip, Tdrop, Tadrtoin, Tparse, There, Ttocounted, There,
         Tbl, Tover, Tcount, Tplus, Tcstore, Texit };
+#endif
 
 /* (S") S" ." for unified code/data space */
 THREAD(xsquote) = { Fenter, Trfrom, Tcount, Ttwodup, Tplus, Taligned, Ttor,
          Texit };
 
+#ifdef SPLIT_DICT
+THREAD(squote) = { Fenter, Tlit, Txsquote, Tcommaxt,
+         Tlit, LIT(0x22), Tword, Tistring, Texit };   /* copied from HERE */
+#else
 THREAD(squote) = { Fenter, Tlit, Txsquote, Tcommaxt,
          Tlit, LIT(0x22), Tword, Tcfetch, Toneplus,
          Taligned, Tallot, Texit };
+#endif
 
 #define Txisquote Txsquote
 #define Tisquote  Tsquote
@@ -988,6 +1459,45 @@ THREAD(nfatolfa) = { Fenter, Tlit, LIT(CELL*2 + 1), Tminus, Texit };
 THREAD(nfatocfa) = {  Fenter, Tlit, LIT(CELL+1), Tminus, Thfetch, Texit };
 THREAD(immedq) = { Fenter, Toneminus, Thcfetch, Tone, Tand, Texit };
 
+#ifdef HASHED_FIND
+#include "dicthash.inc"
+#elif defined(NATIVE_INTERPRET) || defined(FIND_CACHE)
+/* find counted string in dictionary, return its nfa or NULL */
+const unsigned char *dictsearch(const unsigned char *name) {
+    const unsigned char *nfa;
+    for (nfa = (const unsigned char *)Ulatest; nfa != NULL;
+                nfa = NFATOHEADER(nfa)->link) {
+        if (memcmp(nfa, name, name[0] + 1) == 0) return nfa;
+    }
+    return NULL;
+}
+#endif
+
+#ifdef FIND_CACHE
+#include "findcache.inc"
+PRIMITIVE(findname);
+PRIMITIVE(findflush);
+#elif defined(HASHED_FIND) || defined(NATIVE_INTERPRET)
+const unsigned char *dictfind(const unsigned char *name) {
+    return dictsearch(name);
+}
+#endif
+
+#if defined(HASHED_FIND) || defined(FIND_CACHE)
+CODE(find) {    /* c-addr -- c-addr 0   if not found */
+                /*           xt  1      if immediate */
+                /*           xt -1      if "normal"  */
+    const unsigned char *nfa;
+    nfa = dictfind((const unsigned char *)psp[0]);
+    if (nfa == NULL) {
+        *--psp = 0;
+    } else {
+        psp[0] = (unsigned int)NFATOHEADER(nfa)->cfa;
+        *--psp = (NFATOHEADER(nfa)->flags & IMMEDIATE) ? 1 : -1;
+    }
+}
+PRIMITIVE(find);
+#else
 THREAD(find) = { Fenter, Tlatest, Tfetch,
  /*1*/  Ttwodup, Tover, Tcfetch, Tcharplus,
         Tnequal, Tdup, Tqbranch, OFFSET(5 /*2*/),
@@ -997,17 +1507,22 @@ THREAD(find) = { Fenter, Tlatest, Tfetch,
         Tnip, Tdup, Tnfatocfa,
         Tswap, Timmedq, Tzeroequal, Tone, Tor,
  /*3*/  Texit };
+#endif
 
 THREAD(literal) = { Fenter,   
         Tstate, Tfetch, Tqbranch, OFFSET(5),
         Tlit, Tlit, Tcommaxt, Ticomma, 
         Texit };
 
+#ifdef NATIVE_INTERPRET
+PRIMITIVE(digitq);
+#else
 THREAD(digitq) = { Fenter,   
         Tdup, Tlit, LIT(0x39), Tgreater, Tlit, LIT(0x100), Tand, Tplus,
         Tdup, Tlit, LIT(0x140), Tgreater, Tlit, LIT(0x107), Tand,
         Tminus, Tlit, LIT(0x30), Tminus,
         Tdup, Tbase, Tfetch, Tuless, Texit };
+#endif
 
 THREAD(qsign) = { Fenter,   
         Tover, Tcfetch, Tlit, LIT(0x2c), Tminus, Tdup, Tabs,
@@ -1015,6 +1530,10 @@ THREAD(qsign) = { Fenter,
             Toneplus, Ttor, Tone, Tslashstring, Trfrom,
         Texit };
 
+#ifdef NATIVE_INTERPRET
+PRIMITIVE(tonumber);
+PRIMITIVE(qnumber);
+#else
 THREAD(tonumber) = { Fenter,   
  /*1*/  Tdup, Tqbranch, OFFSET(21 /*3*/),
         Tover, Tcfetch, Tdigitq,
@@ -1033,16 +1552,32 @@ THREAD(qnumber) = { Fenter, Tdup, Tzero, Tdup, Trot, Tcount,
         Tnegate,
  /*2*/  Tminusone,
  /*3*/  Texit };
+#endif
 
 extern const void * Tabort[];   /* forward reference */
 
+#ifdef NATIVE_INTERPRET
+PRIMITIVE(xinterpret);
+
+THREAD(interpret) = { Fenter,
+        Tticksource, Ttwostore, Tzero, Ttoin, Tstore,
+ /*1*/  Txinterpret, Tdup, Tqbranch, OFFSET(14 /*3*/),
+        Tzeroless, Tqbranch, OFFSET(4 /*2*/),
+        Tcheckexecute, Tbranch, OFFSET(-9 /*1*/),
+ /*2*/  Tcount, Ttype, Tlit, LIT(0x3f), Temit, Tcr, Tabort,
+ /*3*/  Tdrop,
+#ifdef TX_BUFFER
+        Tflush,                 /* out with the line's output */
+#endif
+        Texit };
+#else
 THREAD(interpret) = { Fenter,   
         Tticksource, Ttwostore, Tzero, Ttoin, Tstore,
  /*1*/  Tbl, Tword, Tdup, Tcfetch, Tqbranch, OFFSET(33 /*9*/),
         Tfind, Tqdup, Tqbranch, OFFSET(14 /*4*/),
         Toneplus, Tstate, Tfetch, Tzeroequal, Tor, 
         Tqbranch, OFFSET(4 /*2*/),
-        Texecute, Tbranch, OFFSET(2 /*3*/),
+        Tcheckexecute, Tbranch, OFFSET(2 /*3*/),
  /*2*/  Tcommaxt,
  /*3*/  Tbranch, OFFSET(14 /*8*/),
  /*4*/  Tqnumber, Tqbranch, OFFSET(4 /*5*/),
@@ -1050,16 +1585,76 @@ THREAD(interpret) = { Fenter,
  /*5*/  Tcount, Ttype, Tlit, LIT(0x3f), Temit, Tcr, Tabort,
  /*6*/
  /*8*/  Tbranch, OFFSET(-37 /*1*/),
- /*9*/  Tdrop, Texit };
+ /*9*/  Tdrop,
+#ifdef TX_BUFFER
+        Tflush,                 /* out with the line's output */
+#endif
+        Texit };
+#endif
 
 THREAD(evaluate) = { Fenter, Tticksource, Ttwofetch, Ttor, Ttor,
         Ttoin, Tfetch, Ttor, Tinterpret,
         Trfrom, Ttoin, Tstore, Trfrom, Trfrom,
         Tticksource, Ttwostore, Texit };
 
+#ifdef LOAD_STREAM
+#include "stream.inc"
+PRIMITIVE(streamstart);
+PRIMITIVE(streamline);
+PRIMITIVE(streamfill);
+PRIMITIVE(streamend);
+PRIMITIVE(streamabort);
+THREAD(loadstream) = { Fenter, Tstreamstart,
+/* 1 */  Tstreamline, Tqbranch, OFFSET(4 /*2*/),
+         Tevaluate, Tbranch, OFFSET(-5 /*1*/),
+#ifdef MULTITASK
+/* 2 */  Tpause, Tstreamfill, Tqbranch, OFFSET(-9 /*1*/),
+#else
+/* 2 */  Tstreamfill, Tqbranch, OFFSET(-8 /*1*/),
+#endif
+         Tstreamend, Texit };
+#endif
+
+#ifdef LOAD_IMAGE
+#include "segment.inc"
+PRIMITIVE(loadsegment);
+#endif
+
+#ifdef BLOCKS
+#include "blocks.inc"
+PRIMITIVE(block);
+PRIMITIVE(buffer);
+PRIMITIVE(update);
+PRIMITIVE(savebuffers);
+PRIMITIVE(emptybuffers);
+PRIMITIVE(blockflush);
+PRIMITIVE(blockload);
+PRIMITIVE(blockunload);
+PRIMITIVE(blockreset);
+PRIMITIVE(list);
+THREAD(blk) = { Fdocon, (void *)&blk };
+THREAD(scr) = { Fdocon, (void *)&scr };
+THREAD(load) = { Fenter, Tblk, Tfetch, Ttor,
+        Tblockload, Tover, Ttor, Tevaluate,
+        Trfrom, Trfrom, Tblockunload, Texit };
+THREAD(thru) = { Fenter, Toneplus, Tswap, Txdo,
+/* 1 */  Ti, Tload, Txloop, OFFSET(-3 /*1*/),
+         Texit };
+#endif
+
 const char okprompt[] = "\003ok ";
 
-THREAD(quit) = { Fenter, Tl0, Tlp, Tstore,
+THREAD(quit) = { Fenter,
+#ifdef NATIVE_COMPILE
+        Tunnative,                      /* leave any native code */
+#endif
+#ifdef LOAD_STREAM
+        Tstreamabort,                   /* report where a load stopped */
+#endif
+#ifdef BLOCKS
+        Tblockreset,                    /* no LOAD is under way */
+#endif
+        Tl0, Tlp, Tstore,
         Tr0, Trpstore, Tzero, Tstate, Tstore,
  /*1*/  Ttib, Tdup, Ttibsize, Taccept, Tspace, Tinterpret,
         Tcr, Tstate, Tfetch, Tzeroequal, Tqbranch, OFFSET(5 /*2*/),
@@ -1068,6 +1663,22 @@ THREAD(quit) = { Fenter, Tl0, Tlp, Tstore,
 
 THREAD(abort) = { Fenter, Ts0, Tspstore, Tquit };
 
+const char dictfullmsg[] = "\017dictionary full";
+
+THREAD(dictfull) = { Tlit, dictfullmsg, Ticount, Titype, Tcr, Tabort };
+
+#ifdef SAVE_SYSTEM
+const char savefailmsg[] = "\013save failed";
+
+THREAD(savefail) = { Tlit, savefailmsg, Ticount, Titype, Tcr, Tabort };
+#endif
+
+#ifdef SPLIT_DICT
+const char codefailmsg[] = "\022flash write failed";
+
+THREAD(codefail) = { Tlit, codefailmsg, Ticount, Titype, Tcr, Tabort };
+#endif
+
 THREAD(qabort) = { Fenter, Trot, Tqbranch, OFFSET(3), Titype, Tabort,
                    Ttwodrop, Texit };
                    
@@ -1089,7 +1700,11 @@ THREAD(paren) = { Fenter, Tlit, LIT(0x29), Tparse, Ttwodrop, Texit };
 /* header is  { link-to-nfa, cfa, flags, name }  where default cfa,
  * in unified memory space, is immediately following header */
 
+#ifdef FIND_CACHE
+THREAD(header) = { Fenter, Tfindflush, Tlatest, Tfetch, Thcomma, /* link */
+#else
 THREAD(header) = { Fenter, Tlatest, Tfetch, Thcomma, /* link */
+#endif
         Thhere, Tcell, Thallot,                 /* reserve cell for cfa */
         Tzero, Thccomma,                        /* flags byte */
         Thhere, Tlatest, Tstore,                /* new latest = nfa */
@@ -1100,14 +1715,24 @@ THREAD(header) = { Fenter, Tlatest, Tfetch, Thcomma, /* link */
  * Fdobuilds is installed by DOES> so we can use CREATE or <BUILDS.
  * Both CREATE and <BUILDS should reserve the two cells */
 
+#ifdef SPLIT_DICT
+THREAD(create) = { Fenter, Theader, Tlit, Fdocreate, Tcommacf, 
+        Tihere, Tcellplus, Ticomma, There, Ticomma, Texit };  /* data in RAM */
+#else
 THREAD(create) = { Fenter, Theader, Tlit, Fdocreate, Tcommacf, 
         Tihere, Tcellplus, Ticomma, Texit };
+#endif
 
 THREAD(builds) = { Fenter, Tcreate, Texit };    /* same as CREATE */
 
+#ifdef SPLIT_DICT
+THREAD(variable) = { Fenter, Theader, Tlit, Fdovar, Tcommacf, 
+        There, Ticomma, Tzero, Tcomma, Texit };     /* cell in RAM */
+#else
 THREAD(variable) = { Fenter, Theader, Tlit, Fdovar, Tcommacf, 
         Tihere, Tcellplus, Ticomma, Tcell, Tiallot, Texit };    
-        /* TODO: this is inline variable. fix for RAM/ROM */
+        /* inline variable: the cell follows the code field */
+#endif
 
 THREAD(constant) = { Fenter, Theader, Tlit, Fdocon, Tcommacf, 
         Ticomma, Texit };
@@ -1142,10 +1767,25 @@ THREAD(reveal) = { Fenter, Tnewest, Tfetch, Tlatest, Tstore, Texit };
 THREAD(immediate) = { Fenter, Tone, Tlatest, Tfetch, 
         Tone, Tchars, Tminus, Thcstore, Texit };
         
+#if defined(SPLIT_DICT) && defined(NATIVE_COMPILE)
+/* the code field is left erased, to be programmed once by ; */
+THREAD(colon) = { Fenter, Theader, Thide, Trightbracket, Tcommanone,
+        Texit };
+#elif defined(SPLIT_DICT)
+/* not CREATE and !COLON, which would program the code field twice */
+THREAD(colon) = { Fenter, Theader, Thide, Trightbracket,
+        Tlit, Fenter, Tcommacf, Texit };
+#else
 THREAD(colon) = { Fenter, Tbuilds, Thide, Trightbracket, Tstorecolon,
         Texit };
+#endif
         
+#ifdef NATIVE_COMPILE
+THREAD(semicolon) = { Fenter, Treveal, Tcommaexit, Tcompilenative,
+        Tleftbracket, Texit };
+#else
 THREAD(semicolon) = { Fenter, Treveal, Tcommaexit, Tleftbracket, Texit };
+#endif
 
 THREAD(brackettick) = { Fenter, Ttick, Tlit, Tlit, Tcommaxt, Ticomma, Texit };
 
@@ -1163,10 +1803,10 @@ THREAD(compile) = { Fenter, Trfrom, Tdup, Tcellplus, Ttor,
 
 THREAD(if) = { Fenter, Tlit, Tqbranch, Tcommabranch, Tihere, Tcommanone,
         Texit };
-THREAD(then) = { Fenter, Tihere, Tswap, Tstoredest, Texit };
+THREAD(then) = { Fenter, Tilabel, Tswap, Tstoredest, Texit };
 THREAD(else) = { Fenter, Tlit, Tbranch, Tcommabranch, Tihere, Tcommanone,
         Tswap, Tthen, Texit };
-THREAD(begin) = { Fenter, Tihere, Texit };
+THREAD(begin) = { Fenter, Tilabel, Texit };
 THREAD(until) = { Fenter, Tlit, Tqbranch, Tcommabranch, Tcommadest, Texit };
 THREAD(again) = { Fenter, Tlit, Tbranch, Tcommabranch, Tcommadest, Texit };
 THREAD(while) = { Fenter, Tif, Tswap, Texit };
@@ -1175,7 +1815,7 @@ THREAD(repeat) = { Fenter, Tagain, Tthen, Texit };
 THREAD(tol) = { Fenter, Tcell, Tlp, Tplusstore, Tlp, Tfetch, Tstore, Texit };
 THREAD(lfrom) = { Fenter, Tlp, Tfetch, Tfetch, Tcell, Tnegate, Tlp, 
         Tplusstore, Texit };
-THREAD(do) = { Fenter, Tlit, Txdo, Tcommaxt, Tihere, Tzero, Ttol, Texit };
+THREAD(do) = { Fenter, Tlit, Txdo, Tcommaxt, Tilabel, Tzero, Ttol, Texit };
 THREAD(endloop) = { Fenter, Tcommabranch, Tcommadest, 
         Tlfrom, Tqdup, Tqbranch, OFFSET(4), Tthen, Tbranch, OFFSET(-6),
         Texit };
@@ -1188,9 +1828,7 @@ THREAD(leave) = { Fenter, Tlit, Tunloop, Tcommaxt,
 
 THREAD(within) = { Fenter, Tover, Tminus, Ttor, Tminus, Trfrom,
         Tuless, Texit };
-THREAD(move) =  { Fenter, Ttor, Ttwodup, Tswap, Tdup, Trfetch, Tplus,
-        Twithin, Tqbranch, OFFSET(5), Trfrom, Tcmoveup, Tbranch, OFFSET(3),
-        Trfrom, Tcmove, Texit };
+PRIMITIVE(move);
 THREAD(depth) = { Fenter, Tspfetch, Ts0, Tswap, Tminus, Tcell, Tslash, 
         Texit };
 THREAD(environmentq) = { Fenter, Ttwodrop, Tzero, Texit };
@@ -1205,11 +1843,25 @@ THREAD() = { Fenter,   Texit };
 /* UTILITY WORDS */
 
 THREAD(marker) = { Fenter, Tlatest, Tfetch, Tihere, There,
-        Tbuilds, Ticomma, Ticomma, Ticomma, Txdoes,
+        Tbuilds, Tcomma, Tcomma, Tcomma, Txdoes,
         /* DOES> action as a headerless Forth word */
-        Fenter, Tdup, Tifetch, Tswap, Tcellplus, Tdup, Tifetch,
-        Tswap, Tcellplus, Tifetch,
-        Tlatest, Tstore, Tidp, Tstore, Tdp, Tstore, Texit };
+        Fenter, Tdup, Tfetch, Tswap, Tcellplus, Tdup, Tfetch,
+        Tswap, Tcellplus, Tfetch,
+        Tlatest, Tstore, Tidp, Tstore, Tdp, Tstore,
+#ifdef FIND_CACHE
+        Tfindflush,                     /* the words it forgets */
+#endif
+        Texit };
+
+#ifdef MULTITASK
+THREAD(task) = { Fenter, Tcreate, There, Tlit, LIT(TASKSIZE), Tdup, Tallot,
+        Tzero, Tfill, Texit };
+PRIMITIVE(activate);
+PRIMITIVE(stop);
+#ifdef MULTICORE
+PRIMITIVE(oncore);
+#endif
+#endif
 
 #define Thcount Tcount
 #define Thtype Ttype
@@ -1226,32 +1878,149 @@ const char coldprompt[] = "\042CamelForth in C v0.1 - 14 Feb 2016 2021:aa";
 
 THREAD(cold) = { Fenter, 
     Tuinit, Tu0, Tninit, Titod,     /* important initialization! */
+#ifdef SAVE_SYSTEM
+    Tloadimage,                     /* saved dictionary, and turnkey xt */
+#endif
     Tlit, coldprompt, Tcount, Ttype, Tcr,
+#ifdef SAVE_SYSTEM
+    Tqdup, Tqbranch, OFFSET(2), Texecute,
+#endif
     Tabort, };                      /* Tabort never exits */
     
 /*
  * INNER INTERPRETER
  */
 
-void interpreter(void)
+#ifdef GOTO_INTERPRETER
+#include "inner_goto.inc"
+#elif defined(TOS_CACHE)
+#error "TOS_CACHE requires GOTO_INTERPRETER"
+#endif
+#if defined(PROFILE) && (defined(GOTO_INTERPRETER) || defined(MULTITASK))
+#error "PROFILE requires the classic inner interpreter, without MULTITASK"
+#endif
+/* NATIVE_TEST: host/nativetest.c, which translates but does not run */
+#if defined(NATIVE_COMPILE) && (defined(MULTITASK) \
+        || !(defined(RP2040_PICO) || defined(NATIVE_TEST)))
+#error "NATIVE_COMPILE is for the RP2040, without MULTITASK"
+#endif
+
+#ifndef GOTO_INTERPRETER
+static void inner(void)
 {
     void (*xt)(void *);     /* pointer to code function */
     void *w, *x;            /* generic pointers */
-    
-    psp = &pstack[PSTACKSIZE-1];
-    rsp = &rstack[RSTACKSIZE-1];
-    ip = &Tcold;
-    ip += CELL;
-    run = 1;                /* set to zero to terminate interpreter */
+
     while (run) {
         w = *(void **)ip;       /* fetch word address from thread */
         ip += CELL;
         x = *(void **)w;        /* fetch function adrs from word def */
         xt = (void (*)())x;     /* too much casting! */
+#ifdef PROFILE
+        if (profiling) {
+            profstep(xt, w);    /* count and time it */
+            continue;
+        }
+#endif
         w += CELL;
         (*xt)(w);               /* call function w/adrs of word def */
     }        
 }
+#endif
+
+static void coldregs(void)  /* registers of the console task */
+{
+    unsigned int i;
+    for (i = 0; i < PSTACKSIZE-1; i++) PSTACK[i] = STACKFILL;
+    for (i = 0; i < RSTACKSIZE-1; i++) RSTACK[i] = STACKFILL;
+    psp = &PSTACK[PSTACKSIZE-1];
+    rsp = &RSTACK[RSTACKSIZE-1];
+#ifdef STACK_CHECK
+    stacklimit(&stacklim, PSTACK, PSTACKSIZE, RSTACK, RSTACKSIZE,
+                lstack, LSTACKSIZE);
+#endif
+#ifdef MULTITASK
+    up = uservars;
+    optask.link = &optask;  /* console task runs alone */
+    optask.tup = uservars;
+    optask.status = TASK_AWAKE;
+    optask.core = 0;
+    optask.linked = 1;
+#ifdef STACK_CHECK
+    optask.limit = stacklim;
+#endif
+    curtask = &optask;
+#endif
+}
+
+void interpreter(void)
+{
+    coldregs();
+    ip = &Tcold;
+    ip += CELL;
+    run = 1;                /* set to zero to terminate interpreter */
+#ifdef NATIVE_COMPILE
+    setjmp(nativejmp);      /* QUIT comes back here from native code */
+    nativejmpok = 1;
+#endif
+    inner();
+}
+
+/* execute one word from C, returning when it does */
+void forth_execute(const void *xt)
+{
+    const void *thread[2];
+    void *saveip;
+
+    thread[0] = xt;
+    thread[1] = Tbye;       /* stops inner() */
+    saveip = ip;
+    ip = (void *)thread;
+    run = 1;
+    inner();
+    ip = saveip;
+}
+
+/* initialize as COLD does, without entering the interpreter */
+void forth_init(void)
+{
+    static const void *init[] = { Tuinit, Tu0, Tninit, Titod, Tbye };
+
+    coldregs();
+    ip = (void *)init;
+    run = 1;
+    inner();
+}
+
+#ifdef MULTICORE
+/* the second core starts with an idle task, which only PAUSEs */
+unsigned int idleuser[USERSIZE];
+unsigned int idlepstack[8], idlerstack[8];
+struct Task idletask;
+THREAD(idle) = { Tpause, Tbranch, OFFSET(-2) };
+
+void taskcore(void)         /* entry point for the second core */
+{
+    memcpy(idleuser, uservars, sizeof(idleuser));
+    idletask.link = &idletask;
+    idletask.tup = idleuser;
+    idletask.status = TASK_AWAKE;
+    idletask.core = 1;
+    idletask.linked = 1;
+    curtask = &idletask;
+    up = idleuser;
+    psp = &idlepstack[7];
+    rsp = &idlerstack[7];
+#ifdef STACK_CHECK
+    stacklimit(&idletask.limit, idlepstack, 8, idlerstack, 8,
+                lstack, LSTACKSIZE);
+    stacklim = idletask.limit;
+#endif
+    ip = (void *)Tidle;
+    run = 1;
+    inner();
+}
+#endif
 
 /*
  * DICTIONARY HEADERS
@@ -1282,7 +2051,7 @@ HEADER(store, fetch, 0, "\001!");
 HEADER(cfetch, store, 0, "\002C@");
 HEADER(cstore, cfetch, 0, "\002C!");
 
-/* synonyms for unified code/data/header space */
+/* code and header space: synonyms for unified space, or SPLIT_DICT */
 HEADER(ifetch, cstore, 0, "\002I@");
 HEADER(istore, ifetch, 0, "\002I!");
 HEADER(icfetch, istore, 0, "\003IC@");
@@ -1377,7 +2146,8 @@ HEADER(here, chars, 0, "\004HERE");
 HEADER(allot, here, 0, "\005ALLOT");
 HEADER(comma, allot, 0, "\001,");
 HEADER(ccomma, comma, 0, "\002C,");
-HEADER(aligned, ccomma, 0, "\007ALIGNED");
+HEADER(unused, ccomma, 0, "\006UNUSED");
+HEADER(aligned, unused, 0, "\007ALIGNED");
 HEADER(align, aligned, 0, "\005ALIGN");
 HEADER(cellplus, align, 0, "\005CELL+");
 HEADER(charplus, cellplus, 0, "\005CHAR+");
@@ -1434,7 +2204,9 @@ HEADER(numgreater, nums, 0, "\002#>");
 HEADER(sign, numgreater, 0, "\004SIGN");
 HEADER(udot, sign, 0, "\002U.");
 HEADER(dot, udot, 0, "\001.");
-HEADER(decimal, dot, 0, "\007DECIMAL");
+HEADER(udotr, dot, 0, "\003U.R");
+HEADER(dotr, udotr, 0, "\002.R");
+HEADER(decimal, dotr, 0, "\007DECIMAL");
 HEADER(hex, decimal, 0, "\003HEX");
 HEADER(source, hex, 0, "\006SOURCE");
 HEADER(slashstring, source, 0, "\007/STRING");
@@ -1510,4 +2282,123 @@ HEADER(dothhhh, dothh, 0, "\005.HHHH");
 HEADER(dots, dothhhh, 0, "\002.S");
 HEADER(dump, dots, 0, "\004DUMP");
 HEADER(words, dump, 0, "\005WORDS");
-HEADER(cold, words, 0, "\004COLD");
+HEADER(dotmem, words, 0, "\004.MEM");
+#define LASTHEADER dotmem
+
+/* optional word sets, each chained on to LASTHEADER */
+#if defined(TX_BUFFER) && !defined(BLOCKS)     /* else FLUSH is the blocks' */
+XHEADER(flush, LASTHEADER, 0, "\005FLUSH");
+#undef LASTHEADER
+#define LASTHEADER flush
+#endif
+
+#ifdef LOAD_STREAM
+XHEADER(loadstream, LASTHEADER, 0, "\013LOAD-STREAM");
+#undef LASTHEADER
+#define LASTHEADER loadstream
+#endif
+
+#ifdef LOAD_IMAGE
+XHEADER(loadsegment, LASTHEADER, 0, "\012LOAD-IMAGE");
+#undef LASTHEADER
+#define LASTHEADER loadsegment
+#endif
+
+#ifdef BLOCKS
+XHEADER(block, LASTHEADER, 0, "\005BLOCK");
+HEADER(buffer, block, 0, "\006BUFFER");
+HEADER(update, buffer, 0, "\006UPDATE");
+HEADER(savebuffers, update, 0, "\014SAVE-BUFFERS");
+HEADER(emptybuffers, savebuffers, 0, "\015EMPTY-BUFFERS");
+HEADER(blockflush, emptybuffers, 0, "\005FLUSH");
+HEADER(load, blockflush, 0, "\004LOAD");
+HEADER(thru, load, 0, "\004THRU");
+HEADER(blk, thru, 0, "\003BLK");
+HEADER(list, blk, 0, "\004LIST");
+HEADER(scr, list, 0, "\003SCR");
+#undef LASTHEADER
+#define LASTHEADER scr
+#endif
+
+#ifdef FIND_CACHE
+XHEADER(findname, LASTHEADER, 0, "\011FIND-NAME");
+#undef LASTHEADER
+#define LASTHEADER findname
+#endif
+
+#ifdef NATIVE_ACCEPT
+XHEADER(echo, LASTHEADER, 0, "\004ECHO");
+#undef LASTHEADER
+#define LASTHEADER echo
+#endif
+
+#ifdef RX_BUFFER
+XHEADER(rxlost, LASTHEADER, 0, "\006RXLOST");
+#undef LASTHEADER
+#define LASTHEADER rxlost
+#endif
+
+#ifdef RP2040_PICO
+XHEADER(bootus, LASTHEADER, 0, "\007BOOT-US");
+#undef LASTHEADER
+#define LASTHEADER bootus
+#endif
+
+#ifdef MULTITASK
+XHEADER(pause, LASTHEADER, 0, "\005PAUSE");
+HEADER(task, pause, 0, "\004TASK");
+HEADER(activate, task, 0, "\010ACTIVATE");
+HEADER(stop, activate, 0, "\004STOP");
+#undef LASTHEADER
+#define LASTHEADER stop
+#endif
+
+#ifdef MULTICORE
+XHEADER(oncore, LASTHEADER, 0, "\007ON-CORE");
+#undef LASTHEADER
+#define LASTHEADER oncore
+#endif
+
+#ifdef PEEPHOLE
+XHEADER(optimize, LASTHEADER, 0, "\010OPTIMIZE");
+HEADER(litplus, optimize, 0, "\004lit+");
+HEADER(fetchplus, litplus, 0, "\002@+");
+HEADER(zeroqbranch, fetchplus, 0, "\0110=?branch");
+#undef LASTHEADER
+#define LASTHEADER zeroqbranch
+#endif
+
+#ifdef NATIVE_COMPILE
+XHEADER(nativeon, LASTHEADER, 0, "\006NATIVE");
+#undef LASTHEADER
+#define LASTHEADER nativeon
+#endif
+
+#ifdef PROFILE
+XHEADER(profileon, LASTHEADER, 0, "\012PROFILE-ON");
+HEADER(profileoff, profileon, 0, "\013PROFILE-OFF");
+HEADER(dotprofile, profileoff, 0, "\010.PROFILE");
+#undef LASTHEADER
+#define LASTHEADER dotprofile
+#endif
+
+#ifdef SAVE_SYSTEM
+XHEADER(savesystem, LASTHEADER, 0, "\013SAVE-SYSTEM");
+HEADER(turnkey, savesystem, 0, "\007TURNKEY");
+HEADER(unsave, turnkey, 0, "\006UNSAVE");
+#undef LASTHEADER
+#define LASTHEADER unsave
+#endif
+
+#ifdef SPLIT_DICT
+XHEADER(idp, LASTHEADER, 0, "\003IDP");
+HEADER(ihere, idp, 0, "\005IHERE");
+HEADER(iallot, ihere, 0, "\006IALLOT");
+HEADER(icomma, iallot, 0, "\002I,");
+HEADER(iccomma, icomma, 0, "\003IC,");
+HEADER(iflush, iccomma, 0, "\006IFLUSH");
+#undef LASTHEADER
+#define LASTHEADER iflush
+#endif
+
+XHEADER(cold, LASTHEADER, 0, "\004COLD");
@@ -31,12 +31,36 @@
  */
 
 // #define INTERPRETER_ONLY       /* to omit Forth compiler words */
+// #define GOTO_INTERPRETER       /* gcc computed-goto inner interpreter */
+// #define TOS_CACHE              /* experimental, top of stack in a local, needs GOTO_INTERPRETER */
+// #define HASHED_FIND            /* native FIND using a hashed dictionary index */
+// #define FIND_CACHE             /* native FIND with a cache of the words last found: FIND-NAME */
+// #define NATIVE_INTERPRET       /* outer interpreter words in C */
+// #define NATIVE_NUMBERS         /* <# # #S #> . U. .R in C */
+// #define NATIVE_DIVIDE          /* / MOD FM/MOD SM/REM etc. in C, RP2040 hardware divider */
+// #define PEEPHOLE               /* fuse common word pairs as compiled: OPTIMIZE */
+// #define NATIVE_COMPILE         /* colon definitions to Thumb code, RP2040 only */
+// #define TX_BUFFER              /* buffered terminal output, RP2040 only */
+// #define RX_BUFFER              /* interrupt driven terminal input, RP2040 only */
+// #define NATIVE_ACCEPT          /* ACCEPT in C: bulk read, batched echo, ECHO */
+// #define LOAD_STREAM            /* paced loading of source from a host: LOAD-STREAM */
+// #define LOAD_IMAGE             /* dictionary segments compiled on the host: LOAD-IMAGE */
+// #define DMA_MOVE               /* large CMOVE/MOVE by DMA, RP2040 only */
+// #define MULTITASK              /* cooperative tasks: TASK ACTIVATE PAUSE STOP */
+// #define MULTICORE              /* tasks on a second core, needs MULTITASK */
+// #define PROFILE                /* per-word counts and times: PROFILE-ON .PROFILE */
+// #define SAVE_SYSTEM            /* dictionary saved to flash: SAVE-SYSTEM TURNKEY */
+// #define SPLIT_DICT             /* code space in flash, data in RAM: IHERE I, I@ */
+// #define STACK_CHECK            /* stack over/underflow is ABORT, not a crash */
+// #define BLOCKS                 /* block storage in flash: BLOCK LOAD FLUSH */
 
 /* define only one of the following */
-// #define LINUX                  /* for development under Linux */
+// #define LINUX                  /* for development under Linux, or -DLINUX */
 // #define TIVA_C                 /* for use with TI TM4C12x */
 // #define SAMDX1                    /* for use with Adafruit Feather M0 Express */
+#ifndef LINUX
 #define RP2040_PICO               /* for use with Raspberry Pi Pico RP2040 based target */
+#endif
 #define USB_IFACE                 /* only some implementations */
 
 /* 
@@ -46,14 +70,52 @@
 #define CELL 4              /* CPU dependency, # of bytes/cell */
 #define CELLWIDTH 32        /* # of bits/cell */
 #define CELLMASK 0xffffffff /* mask for CELLWIDTH bits */
+#define HALFCELL (CELLWIDTH / 2)         /* # of bits/half cell */
+#define HALFMASK (CELLMASK >> HALFCELL)  /* mask for HALFCELL bits */
 
+/* these four may also be given to the compiler, e.g. -DDICTSIZE=131072 */
+#ifndef DICTSIZE
+#define DICTSIZE   65536    /* bytes of dictionary and data space */
+#endif
+#ifndef PSTACKSIZE
 #define PSTACKSIZE 64       /* 64 cells */
+#endif
+#ifndef RSTACKSIZE
 #define RSTACKSIZE 64       /* 64 cells */
+#endif
 #define LSTACKSIZE 32       /* 32 cells */
 #define USERSIZE   32       /* 32 cells */
+#ifndef TIBSIZE
 #define TIBSIZE    84       /* 84 characters */
+#endif
 #define PADSIZE    84       /* 84 characters */
 #define HOLDSIZE   34       /* 34 characters */
+#define DICTINDEX  1024     /* HASHED_FIND: headers indexed */
+#define DICTBUCKETS 256     /* HASHED_FIND: hash buckets, power of 2 */
+#define FINDCACHE  8        /* FIND_CACHE: words remembered, power of 2 */
+#define TXBUFSIZE  1024     /* TX_BUFFER: output ring, power of 2 */
+#define RXBUFSIZE  1024     /* RX_BUFFER: input ring, power of 2 */
+#define DMAMOVEMIN 256      /* DMA_MOVE: smallest move done by DMA */
+#define TASKPSTACK 32       /* MULTITASK: cells in each task's stacks */
+#define TASKRSTACK 32
+#define TASKLSTACK 16
+#define PROFWORDS  256      /* PROFILE: words counted, power of 2 */
+#define NATIVESIZE 16384    /* NATIVE_COMPILE: bytes of code region */
+#define NATIVEOPS  256      /* NATIVE_COMPILE: longest thread translated */
+#define NATIVEPOOL 64       /* NATIVE_COMPILE: constants per definition */
+#define IMAGEPAGE  256      /* SAVE_SYSTEM: unit of writing, a flash page */
+#define IMAGESIZE  (IMAGEPAGE + DICTSIZE + NATIVESIZE)  /* bytes kept for it */
+#define CODESIZE   262144   /* SPLIT_DICT: bytes of flash for code space */
+#define CODEPAGE   256      /* SPLIT_DICT: unit of programming, a flash page */
+#define CODESECTOR 4096     /* SPLIT_DICT: unit of erasing */
+#define STACKGUARD 8        /* STACK_CHECK: spare cells either side of a stack */
+#define KEYBUFSIZE 64       /* NATIVE_ACCEPT: characters read at once */
+#define STREAMSIZE 1024     /* LOAD_STREAM: bytes in a block */
+#define BLOCKBUFS  4        /* BLOCKS: buffers in RAM, 1K each */
+#define BLOCKFLASH 262144   /* BLOCKS: bytes of flash for blocks, whole sectors */
+#define BLOCKCOUNT 128      /* BLOCKS: blocks, at most 2/3 of 3 per sector */
+#define BLOCKPAGE  256      /* BLOCKS: unit of programming, a flash page */
+#define BLOCKSECTOR 4096    /* BLOCKS: unit of erasing */
 
 /*
  * DATA STRUCTURES
@@ -75,12 +137,102 @@ struct Header {
 };
 #endif
  
+/* STACK_CHECK: the stacks of a task.  Its stack pointers are good
+ * while they are no more than the span (in bytes) above the lowest
+ * cell.  The parameter and return stacks are empty at lowest + span,
+ * and grow down; the loop stack is empty at lowest, and grows up. */
+struct StackLimit {
+    unsigned int * plow;
+    unsigned int * rlow;
+    unsigned int * llow;
+    unsigned int pspan, rspan, lspan;
+};
+
+/* task control block; TASK allots one with its user area and stacks */
+struct Task {
+    struct Task * link;     /* next task in this core's round robin */
+    unsigned int * tsp;     /* saved stack pointers */
+    unsigned int * trp;
+    void * tip;             /* saved interpreter pointer */
+    unsigned int * tup;     /* user area */
+    unsigned int status;    /* TASK_AWAKE or TASK_ASLEEP */
+    unsigned int core;      /* core which runs the task */
+    bool linked;            /* in a round robin */
+#ifdef STACK_CHECK
+    struct StackLimit limit;
+#endif
+};
+#define TASK_ASLEEP 0
+#define TASK_AWAKE  1
+
+/* interpreter registers, one set for each core with MULTICORE */
+struct Context {
+    unsigned int * psp;
+    unsigned int * rsp;
+    void * ip;
+    bool run;
+    unsigned int * up;      /* user area of the running task */
+    struct Task * task;     /* the running task */
+#ifdef STACK_CHECK
+    struct StackLimit limit;    /* of the running task */
+#endif
+};
+
+/* LOAD_IMAGE: a dictionary segment, as written by host/forthimage.c.
+ * The header is followed by the dictionary, compiled from offset 0;
+ * the relocations, a cell each; and the names of the built-in words
+ * it uses, each a counted string and an ordinal byte (0 for the
+ * newest word of that name, 1 for the one it hides, ...).  See
+ * segment.inc. */
+struct SegmentHeader {
+    unsigned int magic;     /* SEGMENTMAGIC */
+    unsigned int length;    /* bytes of dictionary, a cell multiple */
+    unsigned int latest;    /* offset of the newest name field, or 0 */
+    unsigned int relocs;    /* number of relocations */
+    unsigned int names;     /* bytes of names */
+    unsigned int sum;       /* FNV-1a of all that follows the header */
+};
+#define SEGMENTMAGIC 0x47534643     /* "CFSG" */
+
+/* FNV-1a of n bytes at p, going on from h (FNVBASIS to start): the
+ * sum of a segment, made by forthimage and checked by LOAD-IMAGE, and
+ * of a SAVE_SYSTEM image.  One copy, so that they cannot differ. */
+#define FNVBASIS 2166136261u
+static inline unsigned int fnvsum(unsigned int h, const void *p,
+                unsigned int n) {
+    const unsigned char *s = p;
+    while (n-- > 0) h = (h ^ *s++) * 16777619u;
+    return h;
+}
+
+/* a relocation: the offset of a cell in the dictionary, and what
+ * the cell holds, to be replaced on loading */
+#define RELOC(offset,kind)  (((offset) << 3) | (kind))
+#define RELOCOFFSET(r)      ((r) >> 3)
+#define RELOCKIND(r)        ((r) & 7)
+#define RELOC_DICT   0      /* an offset into the segment */
+#define RELOC_LATEST 1      /* nothing: LATEST before loading, a link */
+#define RELOC_CODE   2      /* an index into SEGMENTCODE */
+#define RELOC_XT     3      /* an index into the names: its xt */
+#define RELOC_NFA    4      /* an index into the names: its name field */
+#define SEGMENTCODE { Fenter, Fdocon, Fdovar, Fdouser, Fdocreate, \
+                      Fdobuilds, Fdorom }
+
 #define HEADER(name,prev,flags,namestring) const struct Header H##name =\
     { (char *)H##prev.nfa, T##name, flags, namestring }
+/* as HEADER, but prev may be a macro naming the previous header */
+#define XHEADER(name,prev,flags,namestring) HEADER(name,prev,flags,namestring)
 #define IMMEDIATE 1         /* immediate bit in flags */
+#define NFATOHEADER(n) ((const struct Header *) \
+                ((const unsigned char *)(n) - offsetof(struct Header, nfa)))
 
 #define CODE(name)       void F##name (void * pfa)
 #define PRIMITIVE(name)  const void * T##name[] = { F##name }
 #define THREAD(name)     const void * T##name[]
 #define OFFSET(n)   (void *)(n*CELL)       /* see CELL above, = 4 */
 #define LIT(n)      (void *)(n)
+
+/* C API: run the interpreter, or single words for test programs */
+void interpreter(void);
+void forth_init(void);
+void forth_execute(const void *xt);
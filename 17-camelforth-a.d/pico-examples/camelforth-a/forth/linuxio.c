@@ -0,0 +1,243 @@
+/****h* camelforth/linuxio.c
+ * NAME
+ *  linuxio.c
+ * DESCRIPTION
+ *  Terminal I/O for CamelForth in C under Linux, for the host
+ *  build in ../host.  Included by forth.c when LINUX is defined.
+ * SYNOPSIS
+ *  Provides the functions
+ *      void putch(char c)      write one character to terminal
+ *      void putchars(const char *s, unsigned int n)
+ *                              write n characters to terminal
+ *      int getch(void)         await/read one character from keyboard
+ *      int getquery(void)      return true if keyboard char available
+ *      unsigned int getchars(unsigned char *buf, unsigned int max)
+ *                              NATIVE_ACCEPT: await one char, then take
+ *                              up to max-1 more that are already waiting
+ *      unsigned int usecs(void) microseconds, from an arbitrary start
+ *      uint64_t ticks(void)    PROFILE: nanoseconds, from an arbitrary start
+ *      const unsigned char *imagebase(void)   SAVE_SYSTEM: the saved image
+ *      bool imageerase(unsigned int n)        SAVE_SYSTEM: erase it
+ *      void imageprogram(unsigned int offset, const void *src, unsigned int n)
+ *                              SAVE_SYSTEM: write part of it
+ *      CODESPACE               SPLIT_DICT: CODESIZE bytes standing in
+ *                              for flash
+ *      bool codeerase(unsigned int offset)    SPLIT_DICT: erase a CODESECTOR
+ *      bool codeprogram(unsigned int offset, const void *src)
+ *                              SPLIT_DICT: write a CODEPAGE
+ *      const unsigned char *blockflash(void)  BLOCKS: BLOCKFLASH bytes
+ *                              standing in for flash
+ *      bool blockerase(unsigned int offset)   BLOCKS: erase a BLOCKSECTOR
+ *      bool blockprogram(unsigned int offset, const void *src)
+ *                              BLOCKS: write a BLOCKPAGE
+ *      void initTermios(void)  configure terminal for Forth
+ *      void resetTermios(void) reset terminal configuration
+ * NOTES
+ *  When stdin is a terminal it is put in non-canonical mode without
+ *  echo, since ACCEPT does its own echo and editing.  At end of
+ *  input (e.g. a script piped to stdin) the program exits.
+ *  SAVE_SYSTEM keeps its image in the file IMAGEFILE, in the current
+ *  directory.  The SPLIT_DICT code space is in memory, erasing to
+ *  0xff and programming by AND as flash does, and lasts only while
+ *  the program runs; so a saved image is not loaded with SPLIT_DICT.
+ *  BLOCKS keeps its flash in the file BLOCKFILE, in the current
+ *  directory, erased and programmed as flash is and written through
+ *  as it changes; if the file can't be made, blocks can be read (as
+ *  spaces) but not written.  With BLOCK_TEST (host/blocktest.c) the
+ *  write blocktear from now is cut short, as by a reset: half of it
+ *  is done, and it fails.
+ ******
+ */
+
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <time.h>
+
+static struct termios oldtermios;
+static bool termiosset;
+
+void initTermios(void) {
+    struct termios t;
+    setvbuf(stdin, NULL, _IONBF, 0);    /* so getquery() sees all input */
+    if (!isatty(0) || (tcgetattr(0, &oldtermios) != 0)) return;
+    t = oldtermios;
+    t.c_lflag &= ~(ICANON | ECHO);
+    t.c_cc[VMIN] = 1;
+    t.c_cc[VTIME] = 0;
+    tcsetattr(0, TCSANOW, &t);
+    termiosset = 1;
+}
+
+void resetTermios(void) {
+    if (termiosset) tcsetattr(0, TCSANOW, &oldtermios);
+    termiosset = 0;
+}
+
+void putch(char c) {
+    putchar(c);
+}
+
+void putchars(const char *s, unsigned int n) {
+    fwrite(s, 1, n, stdout);
+}
+
+int getch(void) {
+    int c;
+    fflush(stdout);
+    c = getchar();
+    if (c == EOF) {
+        resetTermios();
+        exit(0);
+    }
+    return c;
+}
+
+int getquery(void) {
+    fd_set fds;
+    struct timeval tv = { 0, 0 };
+    fflush(stdout);
+    FD_ZERO(&fds);
+    FD_SET(0, &fds);
+    return (select(1, &fds, NULL, NULL, &tv) > 0) ? -1 : 0;
+}
+
+unsigned int getchars(unsigned char *buf, unsigned int max) {
+    int n;
+    buf[0] = getch();
+    if ((max < 2) || !getquery()) return 1;
+    n = read(0, buf + 1, max - 1);      /* stdin is unbuffered */
+    return (n > 0) ? n + 1 : 1;
+}
+
+unsigned int usecs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned int)ts.tv_sec * 1000000u + (unsigned int)(ts.tv_nsec / 1000);
+}
+
+#define TICKUNITS "ns"
+
+void ticksinit(void) {
+}
+
+uint64_t ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#ifdef SAVE_SYSTEM
+#define IMAGEFILE "camelforth.img"
+
+static unsigned char imagebuf[IMAGESIZE];
+
+const unsigned char *imagebase(void) {
+    FILE *f;
+    memset(imagebuf, 0xff, sizeof(imagebuf));  /* as erased flash */
+    f = fopen(IMAGEFILE, "rb");
+    if (f != NULL) {
+        fread(imagebuf, 1, sizeof(imagebuf), f);
+        fclose(f);
+    }
+    return imagebuf;
+}
+
+bool imageerase(unsigned int n) {
+    FILE *f;
+    (void)n;
+    f = fopen(IMAGEFILE, "wb");         /* truncated */
+    if (f == NULL) return 0;
+    fclose(f);
+    return 1;
+}
+
+void imageprogram(unsigned int offset, const void *src, unsigned int n) {
+    FILE *f;
+    f = fopen(IMAGEFILE, "r+b");
+    if (f == NULL) return;
+    fseek(f, offset, SEEK_SET);
+    fwrite(src, 1, n, f);
+    fclose(f);
+}
+#endif
+
+#ifdef SPLIT_DICT
+static unsigned char codeflash[CODESIZE];
+#define CODESPACE codeflash
+
+bool codeerase(unsigned int offset) {
+    memset(codeflash + offset, 0xff, CODESECTOR);
+    return 1;
+}
+
+bool codeprogram(unsigned int offset, const void *src) {
+    const unsigned char *s = src;
+    unsigned int i;
+    for (i = 0; i < CODEPAGE; i++) codeflash[offset + i] &= s[i];
+    return 1;
+}
+#endif
+
+#ifdef BLOCKS
+#ifndef BLOCKFILE
+#define BLOCKFILE "camelforth.blk"
+#endif
+
+static unsigned char blockfile[BLOCKFLASH];
+static FILE *blockf;
+#ifdef BLOCK_TEST
+int blocktear = -1;             /* erases and programs until a cut, or -1 */
+#endif
+
+const unsigned char *blockflash(void) {
+    memset(blockfile, 0xff, sizeof(blockfile));    /* as erased flash */
+    blockf = fopen(BLOCKFILE, "r+b");
+    if (blockf != NULL) {
+        fread(blockfile, 1, sizeof(blockfile), blockf);
+    } else {
+        blockf = fopen(BLOCKFILE, "w+b");
+        if ((blockf != NULL) && (fwrite(blockfile, 1, sizeof(blockfile), blockf)
+                    != sizeof(blockfile))) {
+            fclose(blockf);
+            blockf = NULL;
+        }
+    }
+    return blockfile;
+}
+
+static bool blockfilewrite(unsigned int offset, unsigned int n) {
+    if (blockf == NULL) return 0;
+    fseek(blockf, offset, SEEK_SET);
+    return (fwrite(blockfile + offset, 1, n, blockf) == n) && (fflush(blockf) == 0);
+}
+
+bool blockerase(unsigned int offset) {
+    if (blockf == NULL) return 0;
+#ifdef BLOCK_TEST
+    if ((blocktear >= 0) && (blocktear-- == 0)) {   /* tag page kept */
+        memset(blockfile + offset + BLOCKSECTOR/2, 0xff, BLOCKSECTOR/2);
+        blockfilewrite(offset + BLOCKSECTOR/2, BLOCKSECTOR/2);
+        return 0;
+    }
+#endif
+    memset(blockfile + offset, 0xff, BLOCKSECTOR);
+    return blockfilewrite(offset, BLOCKSECTOR);
+}
+
+bool blockprogram(unsigned int offset, const void *src) {
+    const unsigned char *s = src;
+    unsigned int i;
+    if (blockf == NULL) return 0;
+#ifdef BLOCK_TEST
+    if ((blocktear >= 0) && (blocktear-- == 0)) {
+        for (i = 0; i < BLOCKPAGE/2; i++) blockfile[offset + i] &= s[i];
+        blockfilewrite(offset, BLOCKPAGE);
+        return 0;
+    }
+#endif
+    for (i = 0; i < BLOCKPAGE; i++) blockfile[offset + i] &= s[i];
+    return blockfilewrite(offset, BLOCKPAGE);
+}
+#endif
@@ -0,0 +1,114 @@
+/*
+ * blocktest: cut block writes short at every point, and check what
+ * the blocks hold afterwards (forth/blocks.inc, BLOCKS).
+ *
+ *  usage: blocktest
+ *
+ * Each case starts from erased flash and writes every block once,
+ * then writes them all again, from the last down.  The second pass
+ * takes the log round past its end, so that sectors are erased and
+ * the blocks still current in them copied forward first.  The n-th erase or program of the second pass is
+ * cut short, half done (BLOCK_TEST, in forth/linuxio.c), and the
+ * flash is then scanned afresh, as after a reset.  Every block must
+ * hold the whole of its first or its second data, the second if its
+ * write was done, and all the blocks must then take a third write.
+ * The cases run for n = 0, 1, ... until the second pass ends before
+ * its cut.  The exit status is the number of cases failed.
+ *
+ * forth.c is compiled in, with BLOCKS and BLOCK_TEST (see
+ * host/CMakeLists.txt), to reach the block functions.  The flash is
+ * the file BLOCKFILE, in the current directory.
+ */
+
+#include "forth.c"
+
+unsigned int failed;
+
+/* the data of block u at write v */
+static void fill(unsigned char *data, unsigned int u, unsigned int v) {
+    unsigned int i;
+    for (i = 0; i < BLOCKSIZE; i++) data[i] = (unsigned char)(u * 7 + v * 31 + i);
+}
+
+/* the k-th block written by write v.  The second goes from the last
+ * block down, so that the log comes round to blocks still current */
+static unsigned int nth(unsigned int k, unsigned int v) {
+    return (v == 2) ? BLOCKCOUNT + 1 - k : k;
+}
+
+/* which of writes 1 to v block u holds the whole of in flash, or 0 */
+static unsigned int holds(unsigned int u, unsigned int v) {
+    unsigned char data[BLOCKSIZE];
+    if (blockmap[u] == NOSLOT) return 0;
+    for ( ; v > 0; v--) {
+        fill(data, u, v);
+        if (memcmp(blockdata(blockmap[u]), data, BLOCKSIZE) == 0) return v;
+    }
+    return 0;
+}
+
+/* as after a reset: the buffers forgotten, the flash scanned again */
+static void reset(void) {
+    if (blockf != NULL) fclose(blockf);
+    blockf = NULL;
+    blockempty();
+    blockscan();
+}
+
+/* write every block as write v; the number written before a failure */
+static unsigned int writeall(unsigned int v) {
+    unsigned char data[BLOCKSIZE];
+    unsigned int k;
+    for (k = 1; k <= BLOCKCOUNT; k++) {
+        fill(data, nth(k, v), v);
+        if (!blocksave(nth(k, v), data)) break;
+    }
+    return k - 1;
+}
+
+/* after done blocks of write v: those hold write v, the one it was
+ * cut in write v or v-1, and the rest v-1; the number which don't */
+static unsigned int expect(int n, unsigned int done, unsigned int v) {
+    unsigned int k, has, bad = 0;
+    for (k = 1; k <= BLOCKCOUNT; k++) {
+        has = holds(nth(k, v), v);
+        if ((k <= done) ? (has == v)
+                : (k > done + 1) ? (has == v - 1)
+                : (has >= v - 1) && (has > 0)) continue;
+        if (bad++ < 4) printf("cut %-4d block %u holds write %u, after %u of write %u\n",
+                    n, nth(k, v), has, done, v);
+    }
+    return bad;
+}
+
+/* case n; false if the second pass ended before the cut */
+static bool tear(int n) {
+    unsigned int done, bad;
+
+    remove(BLOCKFILE);
+    blocktear = -1;
+    reset();
+    writeall(1);
+    bad = expect(n, BLOCKCOUNT, 1);
+    blocktear = n;
+    done = writeall(2);
+    if (blocktear >= 0) {
+        blocktear = -1;
+        return 0;
+    }
+    reset();
+    bad += expect(n, done, 2);
+    writeall(3);
+    reset();
+    bad += expect(n, BLOCKCOUNT, 3);
+    if (bad) failed++;
+    return 1;
+}
+
+int main(void) {
+    int n;
+    for (n = 0; tear(n); n++) ;
+    printf("%d cuts, %u failed\n", n, failed);
+    remove(BLOCKFILE);
+    return failed;
+}
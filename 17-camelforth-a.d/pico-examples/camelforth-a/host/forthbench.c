@@ -0,0 +1,279 @@
+/*
+ * forthbench: micro-benchmarks for CamelForth in C on the host.
+ *
+ *  usage: forthbench [iterations]
+ *
+ * Reports ns/op for
+ *  - each CODE() primitive, called directly with a prepared stack
+ *    (the cost of preparing the stack is measured and subtracted);
+ *  - the inner interpreter: one NEXT, and an Fenter/Fexit nesting;
+ *  - some representative threads, run through forth_execute().
+ * Run it before and after a change to the inner interpreter, with
+ * the same configuration flags in forth.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "forth.h"
+
+#ifdef MULTICORE
+#error "forthbench does not support MULTICORE"
+#endif
+
+/* from forth.c */
+extern unsigned int pstack[], rstack[];
+extern unsigned int *psp, *rsp;
+extern void *ip;
+
+#define P(name) void F##name(void *pfa); extern const void *T##name[];
+P(exit) P(execute) P(lit) P(dup) P(qdup) P(drop) P(swap) P(over) P(rot)
+P(nip) P(tuck) P(tor) P(rfrom) P(rfetch) P(spfetch) P(spstore) P(rpfetch)
+P(rpstore) P(fetch) P(store) P(cfetch) P(cstore) P(plus) P(plusstore)
+P(mplus) P(minus) P(mult) P(div) P(and) P(or) P(xor) P(invert) P(negate)
+P(oneplus) P(oneminus) P(swapbytes) P(twostar) P(twoslash) P(lshift)
+P(rshift) P(zeroequal) P(zeroless) P(equal) P(notequal) P(less)
+P(greater) P(uless) P(ugreater) P(branch) P(qbranch) P(xplusloop)
+P(xloop) P(xdo) P(i) P(j) P(unloop) P(umstar) P(umslashmod) P(fill)
+P(cmove) P(cmoveup) P(move) P(skip) P(scan) P(sequal)
+#undef P
+void Fenter(void *pfa);
+void Fdocon(void *pfa);
+void Fdovar(void *pfa);
+void Fdouser(void *pfa);
+extern const void *Tfind[], *Tinterpret[], *Tdot[];
+
+#define ADR 0xadadadad          /* replaced by the scratch buffer */
+#define BUFLEN 64
+
+unsigned char scratch[2*BUFLEN];
+unsigned int ipcells[4];        /* inline literal/offset of 0 */
+unsigned int pfacell[2];        /* parameter field for docon etc. */
+
+struct Prim {
+    const char *name;
+    void (*fn)(void *);
+    int nin;                    /* parameter stack inputs, top first */
+    unsigned int in[3];
+    int nrin;                   /* return stack inputs, top first */
+    unsigned int rin[3];
+};
+
+struct Prim prims[] = {
+    { "EXIT",       Fexit,      0, {0},            1, {0} },     /* ipcells */
+    { "EXECUTE",    Fexecute,   1, {0},            0, {0} },   /* xt of DUP */
+    { "lit",        Flit,       0, {0},            0, {0} },
+    { "DUP",        Fdup,       1, {1},            0, {0} },
+    { "?DUP",       Fqdup,      1, {1},            0, {0} },
+    { "DROP",       Fdrop,      1, {1},            0, {0} },
+    { "SWAP",       Fswap,      2, {1,2},          0, {0} },
+    { "OVER",       Fover,      2, {1,2},          0, {0} },
+    { "ROT",        Frot,       3, {1,2,3},        0, {0} },
+    { "NIP",        Fnip,       2, {1,2},          0, {0} },
+    { "TUCK",       Ftuck,      2, {1,2},          0, {0} },
+    { ">R",         Ftor,       1, {1},            0, {0} },
+    { "R>",         Frfrom,     0, {0},            1, {1} },
+    { "R@",         Frfetch,    0, {0},            1, {1} },
+    { "SP@",        Fspfetch,   0, {0},            0, {0} },
+    { "SP!",        Fspstore,   1, {0},            0, {0} },   /* psp */
+    { "RP@",        Frpfetch,   0, {0},            0, {0} },
+    { "RP!",        Frpstore,   1, {0},            0, {0} },   /* rsp */
+    { "@",          Ffetch,     1, {ADR},          0, {0} },
+    { "!",          Fstore,     2, {ADR,1},        0, {0} },
+    { "C@",         Fcfetch,    1, {ADR},          0, {0} },
+    { "C!",         Fcstore,    2, {ADR,1},        0, {0} },
+    { "+",          Fplus,      2, {1,2},          0, {0} },
+    { "+!",         Fplusstore, 2, {ADR,1},        0, {0} },
+    { "M+",         Fmplus,     3, {1,2,3},        0, {0} },
+    { "-",          Fminus,     2, {1,2},          0, {0} },
+    { "*",          Fmult,      2, {3,7},          0, {0} },
+    { "/",          Fdiv,       2, {3,1000},       0, {0} },
+    { "AND",        Fand,       2, {1,2},          0, {0} },
+    { "OR",         For,        2, {1,2},          0, {0} },
+    { "XOR",        Fxor,       2, {1,2},          0, {0} },
+    { "INVERT",     Finvert,    1, {1},            0, {0} },
+    { "NEGATE",     Fnegate,    1, {1},            0, {0} },
+    { "1+",         Foneplus,   1, {1},            0, {0} },
+    { "1-",         Foneminus,  1, {1},            0, {0} },
+    { "><",         Fswapbytes, 1, {0x1234},       0, {0} },
+    { "2*",         Ftwostar,   1, {1},            0, {0} },
+    { "2/",         Ftwoslash,  1, {8},            0, {0} },
+    { "LSHIFT",     Flshift,    2, {3,1},          0, {0} },
+    { "RSHIFT",     Frshift,    2, {3,256},        0, {0} },
+    { "0=",         Fzeroequal, 1, {0},            0, {0} },
+    { "0<",         Fzeroless,  1, {1},            0, {0} },
+    { "=",          Fequal,     2, {1,2},          0, {0} },
+    { "<>",         Fnotequal,  2, {1,2},          0, {0} },
+    { "<",          Fless,      2, {1,2},          0, {0} },
+    { ">",          Fgreater,   2, {1,2},          0, {0} },
+    { "U<",         Fuless,     2, {1,2},          0, {0} },
+    { "U>",         Fugreater,  2, {1,2},          0, {0} },
+    { "branch",     Fbranch,    0, {0},            0, {0} },
+    { "?branch",    Fqbranch,   1, {0},            0, {0} },
+    { "(+loop)",    Fxplusloop, 1, {1},            2, {0,10} },
+    { "(loop)",     Fxloop,     0, {0},            2, {0,10} },
+    { "(do)",       Fxdo,       2, {0,10},         0, {0} },
+    { "I",          Fi,         0, {0},            2, {0,10} },
+    { "J",          Fj,         0, {0},            3, {0,10,1} },
+    { "UNLOOP",     Funloop,    0, {0},            2, {0,10} },
+    { "UM*",        Fumstar,    2, {12345,678},    0, {0} },
+    { "UM/MOD",     Fumslashmod, 3, {7,0,1000},    0, {0} },
+    { "FILL",       Ffill,      3, {' ',BUFLEN,ADR}, 0, {0} },
+    { "CMOVE",      Fcmove,     3, {BUFLEN,ADR,ADR+BUFLEN}, 0, {0} },
+    { "CMOVE>",     Fcmoveup,   3, {BUFLEN,ADR,ADR+BUFLEN}, 0, {0} },
+    { "MOVE",       Fmove,      3, {BUFLEN,ADR,ADR+BUFLEN}, 0, {0} },
+    { "SKIP",       Fskip,      3, {'x',BUFLEN,ADR}, 0, {0} },
+    { "SCAN",       Fscan,      3, {'x',BUFLEN,ADR}, 0, {0} },
+    { "S=",         Fsequal,    3, {BUFLEN,ADR,ADR+BUFLEN}, 0, {0} },
+    { "docon",      Fdocon,     0, {0},            0, {0} },
+    { "dovar",      Fdovar,     0, {0},            0, {0} },
+    { "douser",     Fdouser,    0, {0},            0, {0} },
+};
+
+long iterations = 10000000;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void __attribute__((noinline)) Fnothing(void *pfa) {
+    (void)pfa;
+}
+
+/* time n calls of fn, each with the stacks prepared for p */
+static double timecalls(struct Prim *p, void (*fn)(void *), long n) {
+    unsigned int *ptop = &pstack[PSTACKSIZE-8];
+    unsigned int *rtop = &rstack[RSTACKSIZE-8];
+    void (*volatile vfn)(void *) = fn;
+    double t;
+    long k;
+
+    t = now();
+    for (k = 0; k < n; k++) {
+        psp = ptop - p->nin;
+        memcpy(psp, p->in, p->nin * CELL);
+        rsp = rtop - p->nrin;
+        memcpy(rsp, p->rin, p->nrin * CELL);
+        ip = ipcells;
+        vfn(pfacell);
+    }
+    return now() - t;
+}
+
+/* cost of one call of p->fn, less the cost of preparing the stacks;
+ * best of three runs */
+static double timeprim(struct Prim *p, long n) {
+    double t, best;
+    int r;
+
+    best = 1e300;
+    for (r = 0; r < 3; r++) {
+        t = timecalls(p, p->fn, n) - timecalls(p, Fnothing, n);
+        if (t < best) best = t;
+    }
+    return best / n;
+}
+
+/* time n executions of a word, each with a freshly prepared stack */
+static double timeword(const void *xt, int nin, unsigned int *in, long n) {
+    unsigned int *ptop = &pstack[PSTACKSIZE-8];
+    double t;
+    long k;
+
+    t = now();
+    for (k = 0; k < n; k++) {
+        psp = ptop - nin;
+        memcpy(psp, in, nin * CELL);
+        forth_execute(xt);
+    }
+    return now() - t;
+}
+
+static void report(const char *name, double ns) {
+    printf("%-24s %9.2f ns/op\n", name, ns);
+}
+
+#define LOOPS 1000
+
+/* DO loops: empty, one primitive pair, one nested call */
+THREAD(nest0) = { Fenter, Texit };
+THREAD(loop0) = { Fenter, Tlit, LIT(LOOPS), Tlit, LIT(0), Txdo,
+ /*1*/  Txloop, OFFSET(-1 /*1*/), Texit };
+THREAD(loop1) = { Fenter, Tlit, LIT(LOOPS), Tlit, LIT(0), Txdo,
+ /*1*/  Tdup, Tdrop, Txloop, OFFSET(-3 /*1*/), Texit };
+THREAD(loop2) = { Fenter, Tlit, LIT(LOOPS), Tlit, LIT(0), Txdo,
+ /*1*/  Tnest0, Txloop, OFFSET(-2 /*1*/), Texit };
+
+int main(int argc, char *argv[]) {
+    unsigned int in[3];
+    double base, t0, t;
+    unsigned int i;
+    long n;
+    int out, null;
+
+    if (argc > 1) iterations = atol(argv[1]);
+    forth_init();
+
+    for (i = 0; i < sizeof(prims)/sizeof(prims[0]); i++) {
+        for (n = 0; n < 3; n++) {
+            if (prims[i].in[n] == ADR) prims[i].in[n] = (unsigned int)scratch;
+            if (prims[i].in[n] == ADR+BUFLEN)
+                prims[i].in[n] = (unsigned int)&scratch[BUFLEN];
+        }
+    }
+    prims[0].rin[0] = (unsigned int)ipcells;                    /* EXIT */
+    prims[1].in[0] = (unsigned int)Tdup;                        /* EXECUTE */
+    prims[15].in[0] = (unsigned int)&pstack[PSTACKSIZE-8];      /* SP! */
+    prims[17].in[0] = (unsigned int)&rstack[RSTACKSIZE-8];      /* RP! */
+    pfacell[0] = 2;             /* docon value, dovar address, user var */
+
+    printf("CamelForth in C host benchmark, %ld iterations\n\n",
+                iterations);
+    printf("primitives, called directly:\n");
+    for (i = 0; i < sizeof(prims)/sizeof(prims[0]); i++) {
+        report(prims[i].name, timeprim(&prims[i], iterations));
+    }
+
+    printf("\ninner interpreter:\n");
+    n = iterations / LOOPS;
+    t0 = timeword(Tloop0, 0, in, n);
+    report("(loop)", t0 / (n * LOOPS));
+    t = timeword(Tloop1, 0, in, n);
+    report("NEXT", (t - t0) / (n * LOOPS * 2));
+    t = timeword(Tloop2, 0, in, n);
+    report("Fenter/Fexit nesting", (t - t0) / (n * LOOPS));
+
+    printf("\nthreads, through forth_execute():\n");
+    n = iterations / 100;
+    base = timeword(Tdup, 0, in, n);
+    report("forth_execute(DUP)", base / n);
+    in[0] = (unsigned int)"\003DUP";            /* oldest word */
+    report("FIND DUP", timeword(Tfind, 1, in, n) / n);
+    in[0] = (unsigned int)"\004COLD";           /* newest word */
+    report("FIND COLD", timeword(Tfind, 1, in, n) / n);
+    in[0] = (unsigned int)"\005XYZZY";          /* not found */
+    report("FIND XYZZY", timeword(Tfind, 1, in, n) / n);
+    in[0] = 10;
+    in[1] = (unsigned int)"1 2 + DROP";
+    report("INTERPRET 1 2 + DROP", timeword(Tinterpret, 2, in, n) / n);
+
+    fflush(stdout);             /* . output goes to /dev/null */
+    out = dup(1);
+    null = open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+    in[0] = 123456789;
+    t = timeword(Tdot, 1, in, n);
+    fflush(stdout);
+    dup2(out, 1);
+    close(null);
+    close(out);
+    report(". 123456789", t / n);
+    return 0;
+}
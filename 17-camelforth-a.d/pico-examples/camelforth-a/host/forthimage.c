@@ -0,0 +1,315 @@
+/*
+ * forthimage: compile Forth source on the host into a dictionary
+ * segment, for LOAD-IMAGE on the board (forth/segment.inc).
+ *
+ *  usage: forthimage [-o file.img] file.fs ...
+ *
+ * The files are interpreted in turn, as by EVALUATE a line at a
+ * time, and the dictionary they compile is written out with its
+ * relocations.  The default output is the first file's name with
+ * .img in place of .fs.
+ *
+ * The source is compiled twice, each time in a new process, the
+ * second time with the dictionary starting SHIFT bytes higher.  A
+ * cell which differs by SHIFT is an address in the dictionary; one
+ * which differs otherwise depends on HERE in some other way, and is
+ * an error.  Of the cells which do not differ, the LATEST the source
+ * was compiled on is the link of the first header, and a cell equal
+ * to a code field (SEGMENTCODE), or to the xt or name field of a
+ * built-in word, is that; any other is a number.  So a number which
+ * happens to equal the address of a built-in word here is taken for
+ * that word.
+ *
+ * Build it with the same forth.h as the board, so that the words it
+ * compiles with are the words the board has.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "forth.h"
+
+#if defined(MULTICORE) || defined(SPLIT_DICT)
+#error "forthimage does not support MULTICORE or SPLIT_DICT"
+#endif
+
+/* from forth.c */
+extern unsigned int *psp;
+extern unsigned int uservars[];
+extern const struct Header Hcold;
+extern const void *Tevaluate[];
+void Fenter(void *pfa);
+void Fdocon(void *pfa);
+void Fdovar(void *pfa);
+void Fdouser(void *pfa);
+void Fdocreate(void *pfa);
+void Fdobuilds(void *pfa);
+void Fdorom(void *pfa);
+
+#define USTATE  3               /* user variables, as in forth.c */
+#define UDP     4
+#define ULATEST 7
+
+#define SHIFT   (16*CELL)       /* the second compilation is moved up */
+#define LINELEN 1024
+
+struct Pass {                   /* what one compilation made */
+    unsigned char *dict;        /* a copy, zero filled to a cell */
+    unsigned int length;        /* bytes, a cell multiple */
+    unsigned int base;          /* where it was compiled */
+    unsigned int latest;        /* LATEST after, and before */
+    unsigned int latest0;
+};
+
+struct Builtin {                /* a built-in word */
+    const unsigned char *nfa;
+    const void *cfa;
+    unsigned int ordinal;       /* newer words of the same name */
+    int name;                   /* index in the names written, or -1 */
+};
+
+struct Builtin *builtins;
+unsigned int nbuiltins;
+
+const char *srcname;            /* where the source is being read */
+unsigned int srcline;
+bool compiling;
+
+/* an error ABORTs to QUIT, which finds stdin at its end and exits */
+static void stopped(void) {
+    if (compiling) {
+        fflush(stdout);
+        fprintf(stderr, "%s:%u: error\n", srcname, srcline);
+        _exit(1);
+    }
+}
+
+static void compile(int nfiles, char **files, unsigned int shift,
+                struct Pass *p) {
+    char line[LINELEN];
+    unsigned int n, len;
+    FILE *f;
+    int i;
+
+    forth_init();
+    uservars[UDP] += shift;
+    p->base = uservars[UDP];
+    p->latest0 = uservars[ULATEST];
+    compiling = 1;
+    for (i = 0; i < nfiles; i++) {
+        srcname = files[i];
+        srcline = 0;
+        f = fopen(srcname, "r");
+        if (f == NULL) {
+            perror(srcname);
+            exit(1);
+        }
+        while (fgets(line, sizeof(line), f) != NULL) {
+            srcline++;
+            n = strlen(line);
+            if ((n == sizeof(line) - 1) && (line[n-1] != '\n')) {
+                fprintf(stderr, "%s:%u: line too long\n", srcname, srcline);
+                exit(1);
+            }
+            while ((n > 0) && ((line[n-1] == '\n') || (line[n-1] == '\r'))) n--;
+            *--psp = (unsigned int)line;
+            *--psp = n;
+            forth_execute(Tevaluate);
+        }
+        fclose(f);
+    }
+    compiling = 0;
+    if (uservars[USTATE] != 0) {
+        fprintf(stderr, "%s: definition not ended\n", srcname);
+        exit(1);
+    }
+
+    len = uservars[UDP] - p->base;
+    p->length = (len + CELL - 1) & ~(CELL - 1);
+    p->dict = calloc(p->length + CELL, 1);
+    memcpy(p->dict, (void *)p->base, len);
+    p->latest = uservars[ULATEST];
+}
+
+/* read n bytes from fd */
+static bool readall(int fd, void *buf, unsigned int n) {
+    unsigned char *p = buf;
+    ssize_t k;
+    while (n > 0) {
+        k = read(fd, p, n);
+        if (k <= 0) return 0;
+        p += k;
+        n -= k;
+    }
+    return 1;
+}
+
+/* compile in a child process, so that each pass starts from the
+ * same state: the dictionary, and anything not set by a defining
+ * word (padding, the FIND index), as it is at startup */
+static void pass(int nfiles, char **files, unsigned int shift,
+                struct Pass *p) {
+    int fd[2], status;
+    pid_t pid;
+
+    fflush(stdout);
+    if ((pipe(fd) != 0) || ((pid = fork()) < 0)) {
+        perror("forthimage");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        if ((shift != 0) && (freopen("/dev/null", "w", stdout) == NULL)) _exit(1);
+        compile(nfiles, files, shift, p);
+        fflush(stdout);
+        if (!((write(fd[1], p, sizeof(*p)) == sizeof(*p))
+                && (write(fd[1], p->dict, p->length) == p->length))) _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (readall(fd[0], p, sizeof(*p))) {
+        p->dict = calloc(p->length + CELL, 1);
+        if (!readall(fd[0], p->dict, p->length)) p->length = -1;
+    }
+    close(fd[0]);
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status)
+            || (WEXITSTATUS(status) != 0)) exit(1);
+}
+
+/* the built-in words, newest first */
+static void findbuiltins(void) {
+    const unsigned char *nfa, *s;
+    unsigned int i, k;
+
+    for (nfa = (const unsigned char *)Hcold.nfa; nfa != NULL;
+                nfa = NFATOHEADER(nfa)->link) nbuiltins++;
+    builtins = calloc(nbuiltins, sizeof(struct Builtin));
+    i = 0;
+    for (nfa = (const unsigned char *)Hcold.nfa; nfa != NULL;
+                nfa = NFATOHEADER(nfa)->link, i++) {
+        builtins[i].nfa = nfa;
+        builtins[i].cfa = NFATOHEADER(nfa)->cfa;
+        builtins[i].name = -1;
+        for (k = 0; k < i; k++) {           /* count newer namesakes */
+            s = builtins[k].nfa;
+            if ((s[0] == nfa[0]) && (memcmp(s + 1, nfa + 1, nfa[0]) == 0))
+                builtins[i].ordinal++;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    static void (* const code[])(void *) = SEGMENTCODE;
+    const unsigned int ncode = sizeof(code) / sizeof(code[0]);
+    struct Pass p0, p1;
+    struct SegmentHeader h;
+    unsigned int *cells, *relocs, nrelocs = 0, nnames = 0;
+    unsigned char *names;
+    unsigned int namelen = 0, i, k, v0, v1;
+    const char *outname = NULL;
+    char *defname;
+    FILE *f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        if (opt == 'o') outname = optarg;
+        else {
+            fprintf(stderr, "usage: forthimage [-o file.img] file.fs ...\n");
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: forthimage [-o file.img] file.fs ...\n");
+        return 2;
+    }
+    if (outname == NULL) {
+        defname = malloc(strlen(argv[optind]) + 5);
+        strcpy(defname, argv[optind]);
+        if ((strlen(defname) > 3)
+                && (strcmp(defname + strlen(defname) - 3, ".fs") == 0))
+            defname[strlen(defname) - 3] = '\0';
+        strcat(defname, ".img");
+        outname = defname;
+    }
+
+    if (freopen("/dev/null", "r", stdin) == NULL) return 1;
+    atexit(stopped);
+    pass(argc - optind, argv + optind, 0, &p0);
+    pass(argc - optind, argv + optind, SHIFT, &p1);
+    if ((p0.length != p1.length)
+            || (p1.latest - p0.latest != ((p0.latest == p0.latest0) ? 0 : SHIFT))) {
+        fprintf(stderr, "the source does not compile the same twice\n");
+        return 1;
+    }
+    findbuiltins();
+
+    cells = (unsigned int *)p0.dict;
+    relocs = malloc(p0.length / CELL * sizeof(unsigned int));
+    names = malloc(nbuiltins * 34);
+    for (i = 0; i < p0.length / CELL; i++) {
+        v0 = cells[i];
+        v1 = ((unsigned int *)p1.dict)[i];
+        if (v1 - v0 == SHIFT) {
+            cells[i] = v0 - p0.base;
+            relocs[nrelocs++] = RELOC(i * CELL, RELOC_DICT);
+            continue;
+        }
+        if (v1 != v0) {
+            fprintf(stderr, "cell at offset %u depends on HERE, "
+                    "but is not an address\n", i * CELL);
+            return 1;
+        }
+        if (v0 == p0.latest0) {
+            cells[i] = 0;
+            relocs[nrelocs++] = RELOC(i * CELL, RELOC_LATEST);
+            continue;
+        }
+        for (k = 0; (k < ncode) && (v0 != (unsigned int)code[k]); k++) ;
+        if (k < ncode) {
+            cells[i] = k;
+            relocs[nrelocs++] = RELOC(i * CELL, RELOC_CODE);
+            continue;
+        }
+        for (k = 0; k < nbuiltins; k++) {
+            if ((v0 == (unsigned int)builtins[k].cfa)
+                    || (v0 == (unsigned int)builtins[k].nfa)) break;
+        }
+        if (k == nbuiltins) continue;           /* a number */
+        if (builtins[k].name < 0) {             /* name it */
+            builtins[k].name = nnames++;
+            memcpy(&names[namelen], builtins[k].nfa, builtins[k].nfa[0] + 1);
+            namelen += builtins[k].nfa[0] + 1;
+            names[namelen++] = builtins[k].ordinal;
+        }
+        relocs[nrelocs++] = RELOC(i * CELL, (v0 == (unsigned int)builtins[k].cfa)
+                ? RELOC_XT : RELOC_NFA);
+        cells[i] = builtins[k].name;
+    }
+
+    h.magic = SEGMENTMAGIC;
+    h.length = p0.length;
+    h.latest = (p0.latest == p0.latest0) ? 0 : p0.latest - p0.base;
+    h.relocs = nrelocs;
+    h.names = namelen;
+    h.sum = fnvsum(FNVBASIS, p0.dict, p0.length);
+    h.sum = fnvsum(h.sum, relocs, nrelocs * CELL);
+    h.sum = fnvsum(h.sum, names, namelen);
+
+    f = fopen(outname, "wb");
+    if ((f == NULL) || (fwrite(&h, sizeof(h), 1, f) != 1)
+            || (fwrite(p0.dict, 1, p0.length, f) != p0.length)
+            || (fwrite(relocs, CELL, nrelocs, f) != nrelocs)
+            || (fwrite(names, 1, namelen, f) != namelen)
+            || (fclose(f) != 0)) {
+        perror(outname);
+        return 1;
+    }
+    fprintf(stderr, "%s: %u bytes, %u relocations, %u built-in words\n",
+            outname, h.length, nrelocs, nnames);
+    return 0;
+}
@@ -0,0 +1,16 @@
+/*
+ * main() for the host (Linux) build of CamelForth in C.
+ */
+
+#include <stdbool.h>
+#include "forth.h"
+
+void initTermios(void);
+void resetTermios(void);
+
+int main(void) {
+    initTermios();
+    interpreter();          /* returns after BYE */
+    resetTermios();
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * nativetest: check the Thumb code made by the native compiler
+ * (forth/native.inc, NATIVE_COMPILE) on the host, without running it.
+ *
+ *  usage: nativetest
+ *
+ * Each case is the thread of a colon definition, translated as ;
+ * translates it, into a code region emptied for the case.  The
+ * halfwords made are compared with encodings checked by hand against
+ * the ARMv6-M Architecture Reference Manual; the literal pool and
+ * veneers, which hold addresses of this build, are compared with
+ * those addresses.  The exit status is the number of cases failed.
+ *
+ * forth.c is compiled in, with NATIVE_COMPILE and NATIVE_TEST (see
+ * host/CMakeLists.txt), to reach the translator's static functions.
+ * nativetest-split is the same test built with SPLIT_DICT, where a
+ * CREATEd word holds the address of its data in RAM.
+ */
+
+#include "forth.c"
+
+#define MAXCODE 200             /* halfwords in a case */
+
+/* Thumb halfwords common to the cases, as checked by hand */
+#define PUSH_R4R5R6LR   0xb570  /* push {r4, r5, r6, lr} */
+#define LDR_R4_R5       0x682c  /* ldr r4, [r5]      psp from memory */
+#define STR_R4_R5       0x602c  /* str r4, [r5]      psp to memory */
+#define POP_R4R5R6PC    0xbd70  /* pop {r4, r5, r6, pc} */
+#define DUP1            0x6820  /* ldr r0, [r4]      DUP */
+#define DUP2            0x3c04  /* subs r4, #4 */
+#define DUP3            0x6020  /* str r0, [r4] */
+
+unsigned int failed;
+
+/* translate the definition of cells cells at word; its code, or NULL */
+static const uint16_t *translate(const void **word, unsigned int cells) {
+    nativehere = (uint8_t *)nativecode;
+    nativeveneer = (uint8_t *)&nativecode[NATIVESIZE/4];
+    memset(nativecode, 0, sizeof(nativecode));
+    return (const uint16_t *)nativetranslate((void **)word, word + cells);
+}
+
+/* compare n halfwords of code with want, and the pool after them */
+static void check(const char *name, const uint16_t *code,
+                const uint16_t *want, unsigned int n,
+                const uint32_t *pool, unsigned int npool) {
+    const uint32_t *at;
+    unsigned int i, bad = 0;
+
+    if (code == NULL) {
+        printf("%-24s not translated\n", name);
+        failed++;
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        if (code[i] != want[i]) {
+            if (bad++ < 4) printf("%-24s halfword %u is %04x, not %04x\n",
+                        name, i, code[i], want[i]);
+        }
+    }
+    at = (const uint32_t *)&code[(n + 1) & ~1];
+    for (i = 0; i < npool; i++) {
+        if (at[i] != pool[i]) {
+            if (bad++ < 4) printf("%-24s pool word %u is %08x, not %08x\n",
+                        name, i, at[i], pool[i]);
+        }
+    }
+    if ((uint8_t *)&at[npool] != nativehere) {
+        if (bad++ < 4) printf("%-24s %u bytes, not %u\n", name,
+                    (unsigned int)(nativehere - (uint8_t *)code),
+                    (unsigned int)((uint8_t *)&at[npool] - (uint8_t *)code));
+    }
+    printf("%-24s %s\n", name, bad ? "FAILED" : "ok");
+    if (bad) failed++;
+}
+
+/* : T  DUP + @ ; */
+static void inlines1(void) {
+    static const void *word[] = { Fenter, Tdup, Tplus, Tfetch, Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR,
+        0x4d07,                 /* ldr r5, [pc, #28]  &psp */
+        0x4e07,                 /* ldr r6, [pc, #28]  &rsp */
+        LDR_R4_R5,
+        DUP1, DUP2, DUP3,
+        0xcc01,                 /* ldmia r4!, {r0}    + */
+        0x6821,                 /* ldr r1, [r4] */
+        0x1809,                 /* adds r1, r1, r0 */
+        0x6021,                 /* str r1, [r4] */
+        0x6820,                 /* ldr r0, [r4]       @ */
+        0x6800,                 /* ldr r0, [r0] */
+        0x6020,                 /* str r0, [r4] */
+        STR_R4_R5, POP_R4R5R6PC,
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+    check("DUP + @", translate(word, 5), want, 16, pool, 2);
+}
+
+/* : T  5 -3 1000 ; */
+static void literals(void) {
+    static const void *word[] = { Fenter, Tlit, LIT(5), Tlit, LIT(-3),
+                Tlit, LIT(1000), Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR, 0x4d07, 0x4e07, LDR_R4_R5,
+        0x3c04,                 /* subs r4, #4        5 */
+        0x2005,                 /* movs r0, #5 */
+        0x6020,                 /* str r0, [r4] */
+        0x3c04,                 /* subs r4, #4        -3 */
+        0x2003,                 /* movs r0, #3 */
+        0x4240,                 /* rsbs r0, r0, #0 */
+        0x6020,                 /* str r0, [r4] */
+        0x3c04,                 /* subs r4, #4        1000 */
+        0x4803,                 /* ldr r0, [pc, #12]  pool word 2 */
+        0x6020,                 /* str r0, [r4] */
+        STR_R4_R5, POP_R4R5R6PC,
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp, 1000 };
+    check("literals", translate(word, 8), want, 16, pool, 3);
+}
+
+/* : T  BEGIN DUP UNTIL ; */
+static void backward(void) {
+    static const void *word[] = { Fenter, Tdup, Tqbranch, OFFSET(-2),
+                Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR,
+        0x4d05,                 /* ldr r5, [pc, #20] */
+        0x4e05,                 /* ldr r6, [pc, #20] */
+        LDR_R4_R5,
+        DUP1, DUP2, DUP3,       /* at byte 8 */
+        0xcc01,                 /* ldmia r4!, {r0} */
+        0x2800,                 /* cmp r0, #0 */
+        0xd0f9,                 /* beq.n byte 8 */
+        STR_R4_R5, POP_R4R5R6PC,
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+    check("?branch backward", translate(word, 5), want, 12, pool, 2);
+}
+
+/* : T  IF DUP THEN ; */
+static void forward(void) {
+    static const void *word[] = { Fenter, Tqbranch, OFFSET(2), Tdup,
+                Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR, 0x4d05, 0x4e05, LDR_R4_R5,
+        0xcc01,                 /* ldmia r4!, {r0} */
+        0x2800,                 /* cmp r0, #0 */
+        0xd002,                 /* beq.n byte 20 */
+        DUP1, DUP2, DUP3,
+        STR_R4_R5, POP_R4R5R6PC,    /* at byte 20 */
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+    check("?branch forward", translate(word, 5), want, 12, pool, 2);
+}
+
+/* : T  IF DUP ... (50 DUPs) THEN ;  the ?branch is out of range */
+static void relaxed(void) {
+    static const void *word[55];
+    uint16_t want[MAXCODE];
+    unsigned int i, n;
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+
+    word[0] = Fenter;
+    word[1] = Tqbranch;
+    word[2] = OFFSET(51);
+    for (i = 3; i < 53; i++) word[i] = Tdup;
+    word[53] = Texit;
+
+    n = 0;
+    want[n++] = PUSH_R4R5R6LR;
+    want[n++] = 0x4d50;         /* ldr r5, [pc, #320] */
+    want[n++] = 0x4e50;         /* ldr r6, [pc, #320] */
+    want[n++] = LDR_R4_R5;
+    want[n++] = 0xcc01;         /* ldmia r4!, {r0} */
+    want[n++] = 0x2800;         /* cmp r0, #0 */
+    want[n++] = 0xd101;         /* bne.n byte 18, over the bl */
+    want[n++] = 0xf000;         /* bl byte 318 */
+    want[n++] = 0xf896;
+    for (i = 0; i < 50; i++) {  /* from byte 18 */
+        want[n++] = DUP1;
+        want[n++] = DUP2;
+        want[n++] = DUP3;
+    }
+    want[n++] = STR_R4_R5;      /* at byte 318 */
+    want[n++] = POP_R4R5R6PC;
+    want[n++] = 0xbf00;         /* nop, to align the pool */
+    check("?branch relaxed to bl", translate(word, 54), want, n, pool, 2);
+}
+
+/* : T  10 0 DO I LOOP ; */
+static void doloop(void) {
+    static const void *word[] = { Fenter, Tlit, LIT(10), Tlit, LIT(0),
+                Txdo, Ti, Txloop, OFFSET(-2), Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR,
+        0x4d0f,                 /* ldr r5, [pc, #60] */
+        0x4e0f,                 /* ldr r6, [pc, #60] */
+        LDR_R4_R5,
+        0x3c04, 0x200a, 0x6020, /* 10 */
+        0x3c04, 0x2000, 0x6020, /* 0 */
+        0xcc03,                 /* ldmia r4!, {r0, r1}    (do) */
+        0x6832,                 /* ldr r2, [r6] */
+        0x3a08,                 /* subs r2, #8 */
+        0x6010,                 /* str r0, [r2] */
+        0x6051,                 /* str r1, [r2, #4] */
+        0x6032,                 /* str r2, [r6] */
+        0x6832,                 /* ldr r2, [r6]   I, at byte 32 */
+        0x6810,                 /* ldr r0, [r2] */
+        0x3c04, 0x6020,
+        0x6832,                 /* ldr r2, [r6]   (loop) */
+        0x6810,                 /* ldr r0, [r2] */
+        0x3001,                 /* adds r0, #1 */
+        0x6010,                 /* str r0, [r2] */
+        0x6851,                 /* ldr r1, [r2, #4] */
+        0x4288,                 /* cmp r0, r1 */
+        0xd1f4,                 /* bne.n byte 32 */
+        0x3208,                 /* adds r2, #8 */
+        0x6032,                 /* str r2, [r6] */
+        STR_R4_R5, POP_R4R5R6PC,
+        0xbf00,                 /* nop */
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+    check("DO LOOP", translate(word, 10), want, 32, pool, 2);
+}
+
+/* : T  10 0 DO I 2 +LOOP ; */
+static void plusloop(void) {
+    static const void *word[] = { Fenter, Tlit, LIT(10), Tlit, LIT(0),
+                Txdo, Ti, Tlit, LIT(2), Txplusloop, OFFSET(-4), Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR,
+        0x4d12,                 /* ldr r5, [pc, #72] */
+        0x4e12,                 /* ldr r6, [pc, #72] */
+        LDR_R4_R5,
+        0x3c04, 0x200a, 0x6020,
+        0x3c04, 0x2000, 0x6020,
+        0xcc03, 0x6832, 0x3a08, 0x6010, 0x6051, 0x6032,    /* (do) */
+        0x6832, 0x6810, 0x3c04, 0x6020,     /* I, at byte 32 */
+        0x3c04, 0x2002, 0x6020,             /* 2 */
+        0xcc08,                 /* ldmia r4!, {r3}    (+loop) */
+        0x6832,                 /* ldr r2, [r6] */
+        0x6810,                 /* ldr r0, [r2]       index */
+        0x6851,                 /* ldr r1, [r2, #4]   limit */
+        0x1a41,                 /* subs r1, r0, r1 */
+        0x18c0,                 /* adds r0, r0, r3 */
+        0x6010,                 /* str r0, [r2] */
+        0x185b,                 /* adds r3, r3, r1 */
+        0x404b,                 /* eors r3, r1 */
+        0xd5ee,                 /* bpl.n byte 32 */
+        0x3208, 0x6032,
+        STR_R4_R5, POP_R4R5R6PC,
+        0xbf00,
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp };
+    check("DO +LOOP", translate(word, 12), want, 38, pool, 2);
+}
+
+/* CREATE X  : T  X ; */
+static void create(void) {
+#ifdef SPLIT_DICT
+    static unsigned int data;   /* in RAM, its address in the word */
+    static const void *x[] = { Fdocreate, NULL, &data };
+#else
+    static const void *x[] = { Fdocreate, NULL, LIT(0) };
+#endif
+    static const void *word[] = { Fenter, x, Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR,
+        0x4d04,                 /* ldr r5, [pc, #16] */
+        0x4e04,                 /* ldr r6, [pc, #16] */
+        LDR_R4_R5,
+        0x3c04,                 /* subs r4, #4 */
+        0x4804,                 /* ldr r0, [pc, #16]  pool word 2 */
+        0x6020,                 /* str r0, [r4] */
+        STR_R4_R5, POP_R4R5R6PC,
+        0xbf00,
+    };
+#ifdef SPLIT_DICT
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp,
+                (uint32_t)&data };
+#else
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp,
+                (uint32_t)&x[2] };      /* its data field */
+#endif
+    check("CREATE", translate(word, 3), want, 10, pool, 3);
+}
+
+/* : T  >< ;  a CODE word, out of BL range of the code region */
+static void veneer(void) {
+    static const void *word[] = { Fenter, Tswapbytes, Texit };
+    static const uint16_t want[] = {
+        PUSH_R4R5R6LR, 0x4d05, 0x4e05, LDR_R4_R5,
+        STR_R4_R5,
+        0x4805,                 /* ldr r0, [pc, #20]  pfa, pool word 2 */
+        0xf003,                 /* bl byte 16376, the veneer */
+        0xfff4,
+        LDR_R4_R5,
+        STR_R4_R5, POP_R4R5R6PC,
+        0xbf00,                 /* nop */
+    };
+    const uint32_t pool[] = { (uint32_t)&psp, (uint32_t)&rsp,
+                (uint32_t)(Tswapbytes + 1) };
+    const uint16_t *code;
+    const uint32_t *v;
+
+    code = translate(word, 3);
+    check("call through a veneer", code, want, 12, pool, 3);
+    v = &nativecode[NATIVESIZE/4 - 2];
+    if ((nativeveneer != (uint8_t *)v) || (((uint16_t *)v)[0] != 0x4b00)
+            || (((uint16_t *)v)[1] != 0x4718)
+            || (v[1] != (uint32_t)Fswapbytes)) {
+        /* ldr r3, [pc, #0]; bx r3; .word Fswapbytes */
+        printf("%-24s FAILED\n", "the veneer");
+        failed++;
+    } else {
+        printf("%-24s ok\n", "the veneer");
+    }
+}
+
+int main(void) {
+    inlines1();
+    literals();
+    backward();
+    forward();
+    relaxed();
+    doloop();
+    plusloop();
+    create();
+    veneer();
+    return failed;
+}
@@ -0,0 +1,173 @@
+( streamtest.fs: the LOAD-STREAM loopback test, run by ctest:      )
+( loadstream.py --exec camelforth-stream streamtest.fs             )
+( Each N L line checks that it is line N of them: none lost,       )
+( none repeated, none out of order, over several blocks.           )
+
+VARIABLE LINES  0 LINES !
+: L  ( n -- )  LINES @ 1+ DUP LINES !
+    <> ABORT" streamtest: a line was lost" ;
+: SQUARES  ( n -- sum )  0 SWAP 0 DO
+    I I * +
+  LOOP ;
+1 L       ( a line of padding, so that the source spans several blocks )
+2 L       ( a line of padding, so that the source spans several blocks )
+3 L       ( a line of padding, so that the source spans several blocks )
+4 L       ( a line of padding, so that the source spans several blocks )
+5 L       ( a line of padding, so that the source spans several blocks )
+6 L       ( a line of padding, so that the source spans several blocks )
+7 L       ( a line of padding, so that the source spans several blocks )
+8 L       ( a line of padding, so that the source spans several blocks )
+9 L       ( a line of padding, so that the source spans several blocks )
+10 L      ( a line of padding, so that the source spans several blocks )
+11 L      ( a line of padding, so that the source spans several blocks )
+12 L      ( a line of padding, so that the source spans several blocks )
+13 L      ( a line of padding, so that the source spans several blocks )
+14 L      ( a line of padding, so that the source spans several blocks )
+15 L      ( a line of padding, so that the source spans several blocks )
+16 L      ( a line of padding, so that the source spans several blocks )
+17 L      ( a line of padding, so that the source spans several blocks )
+18 L      ( a line of padding, so that the source spans several blocks )
+19 L      ( a line of padding, so that the source spans several blocks )
+20 L      ( a line of padding, so that the source spans several blocks )
+21 L      ( a line of padding, so that the source spans several blocks )
+22 L      ( a line of padding, so that the source spans several blocks )
+23 L      ( a line of padding, so that the source spans several blocks )
+24 L      ( a line of padding, so that the source spans several blocks )
+25 L      ( a line of padding, so that the source spans several blocks )
+26 L      ( a line of padding, so that the source spans several blocks )
+27 L      ( a line of padding, so that the source spans several blocks )
+28 L      ( a line of padding, so that the source spans several blocks )
+29 L      ( a line of padding, so that the source spans several blocks )
+30 L      ( a line of padding, so that the source spans several blocks )
+31 L      ( a line of padding, so that the source spans several blocks )
+32 L      ( a line of padding, so that the source spans several blocks )
+33 L      ( a line of padding, so that the source spans several blocks )
+34 L      ( a line of padding, so that the source spans several blocks )
+35 L      ( a line of padding, so that the source spans several blocks )
+36 L      ( a line of padding, so that the source spans several blocks )
+37 L      ( a line of padding, so that the source spans several blocks )
+38 L      ( a line of padding, so that the source spans several blocks )
+39 L      ( a line of padding, so that the source spans several blocks )
+40 L      ( a line of padding, so that the source spans several blocks )
+41 L      ( a line of padding, so that the source spans several blocks )
+42 L      ( a line of padding, so that the source spans several blocks )
+43 L      ( a line of padding, so that the source spans several blocks )
+44 L      ( a line of padding, so that the source spans several blocks )
+45 L      ( a line of padding, so that the source spans several blocks )
+46 L      ( a line of padding, so that the source spans several blocks )
+47 L      ( a line of padding, so that the source spans several blocks )
+48 L      ( a line of padding, so that the source spans several blocks )
+49 L      ( a line of padding, so that the source spans several blocks )
+50 L      ( a line of padding, so that the source spans several blocks )
+51 L      ( a line of padding, so that the source spans several blocks )
+52 L      ( a line of padding, so that the source spans several blocks )
+53 L      ( a line of padding, so that the source spans several blocks )
+54 L      ( a line of padding, so that the source spans several blocks )
+55 L      ( a line of padding, so that the source spans several blocks )
+56 L      ( a line of padding, so that the source spans several blocks )
+57 L      ( a line of padding, so that the source spans several blocks )
+58 L      ( a line of padding, so that the source spans several blocks )
+59 L      ( a line of padding, so that the source spans several blocks )
+60 L      ( a line of padding, so that the source spans several blocks )
+61 L      ( a line of padding, so that the source spans several blocks )
+62 L      ( a line of padding, so that the source spans several blocks )
+63 L      ( a line of padding, so that the source spans several blocks )
+64 L      ( a line of padding, so that the source spans several blocks )
+65 L      ( a line of padding, so that the source spans several blocks )
+66 L      ( a line of padding, so that the source spans several blocks )
+67 L      ( a line of padding, so that the source spans several blocks )
+68 L      ( a line of padding, so that the source spans several blocks )
+69 L      ( a line of padding, so that the source spans several blocks )
+70 L      ( a line of padding, so that the source spans several blocks )
+71 L      ( a line of padding, so that the source spans several blocks )
+72 L      ( a line of padding, so that the source spans several blocks )
+73 L      ( a line of padding, so that the source spans several blocks )
+74 L      ( a line of padding, so that the source spans several blocks )
+75 L      ( a line of padding, so that the source spans several blocks )
+76 L      ( a line of padding, so that the source spans several blocks )
+77 L      ( a line of padding, so that the source spans several blocks )
+78 L      ( a line of padding, so that the source spans several blocks )
+79 L      ( a line of padding, so that the source spans several blocks )
+80 L      ( a line of padding, so that the source spans several blocks )
+10 SQUARES 285 <> ABORT" streamtest: SQUARES"
+81 L      ( a line of padding, so that the source spans several blocks )
+82 L      ( a line of padding, so that the source spans several blocks )
+83 L      ( a line of padding, so that the source spans several blocks )
+84 L      ( a line of padding, so that the source spans several blocks )
+85 L      ( a line of padding, so that the source spans several blocks )
+86 L      ( a line of padding, so that the source spans several blocks )
+87 L      ( a line of padding, so that the source spans several blocks )
+88 L      ( a line of padding, so that the source spans several blocks )
+89 L      ( a line of padding, so that the source spans several blocks )
+90 L      ( a line of padding, so that the source spans several blocks )
+91 L      ( a line of padding, so that the source spans several blocks )
+92 L      ( a line of padding, so that the source spans several blocks )
+93 L      ( a line of padding, so that the source spans several blocks )
+94 L      ( a line of padding, so that the source spans several blocks )
+95 L      ( a line of padding, so that the source spans several blocks )
+96 L      ( a line of padding, so that the source spans several blocks )
+97 L      ( a line of padding, so that the source spans several blocks )
+98 L      ( a line of padding, so that the source spans several blocks )
+99 L      ( a line of padding, so that the source spans several blocks )
+100 L     ( a line of padding, so that the source spans several blocks )
+101 L     ( a line of padding, so that the source spans several blocks )
+102 L     ( a line of padding, so that the source spans several blocks )
+103 L     ( a line of padding, so that the source spans several blocks )
+104 L     ( a line of padding, so that the source spans several blocks )
+105 L     ( a line of padding, so that the source spans several blocks )
+106 L     ( a line of padding, so that the source spans several blocks )
+107 L     ( a line of padding, so that the source spans several blocks )
+108 L     ( a line of padding, so that the source spans several blocks )
+109 L     ( a line of padding, so that the source spans several blocks )
+110 L     ( a line of padding, so that the source spans several blocks )
+111 L     ( a line of padding, so that the source spans several blocks )
+112 L     ( a line of padding, so that the source spans several blocks )
+113 L     ( a line of padding, so that the source spans several blocks )
+114 L     ( a line of padding, so that the source spans several blocks )
+115 L     ( a line of padding, so that the source spans several blocks )
+116 L     ( a line of padding, so that the source spans several blocks )
+117 L     ( a line of padding, so that the source spans several blocks )
+118 L     ( a line of padding, so that the source spans several blocks )
+119 L     ( a line of padding, so that the source spans several blocks )
+120 L     ( a line of padding, so that the source spans several blocks )
+121 L     ( a line of padding, so that the source spans several blocks )
+122 L     ( a line of padding, so that the source spans several blocks )
+123 L     ( a line of padding, so that the source spans several blocks )
+124 L     ( a line of padding, so that the source spans several blocks )
+125 L     ( a line of padding, so that the source spans several blocks )
+126 L     ( a line of padding, so that the source spans several blocks )
+127 L     ( a line of padding, so that the source spans several blocks )
+128 L     ( a line of padding, so that the source spans several blocks )
+129 L     ( a line of padding, so that the source spans several blocks )
+130 L     ( a line of padding, so that the source spans several blocks )
+131 L     ( a line of padding, so that the source spans several blocks )
+132 L     ( a line of padding, so that the source spans several blocks )
+133 L     ( a line of padding, so that the source spans several blocks )
+134 L     ( a line of padding, so that the source spans several blocks )
+135 L     ( a line of padding, so that the source spans several blocks )
+136 L     ( a line of padding, so that the source spans several blocks )
+137 L     ( a line of padding, so that the source spans several blocks )
+138 L     ( a line of padding, so that the source spans several blocks )
+139 L     ( a line of padding, so that the source spans several blocks )
+140 L     ( a line of padding, so that the source spans several blocks )
+141 L     ( a line of padding, so that the source spans several blocks )
+142 L     ( a line of padding, so that the source spans several blocks )
+143 L     ( a line of padding, so that the source spans several blocks )
+144 L     ( a line of padding, so that the source spans several blocks )
+145 L     ( a line of padding, so that the source spans several blocks )
+146 L     ( a line of padding, so that the source spans several blocks )
+147 L     ( a line of padding, so that the source spans several blocks )
+148 L     ( a line of padding, so that the source spans several blocks )
+149 L     ( a line of padding, so that the source spans several blocks )
+150 L     ( a line of padding, so that the source spans several blocks )
+151 L     ( a line of padding, so that the source spans several blocks )
+152 L     ( a line of padding, so that the source spans several blocks )
+153 L     ( a line of padding, so that the source spans several blocks )
+154 L     ( a line of padding, so that the source spans several blocks )
+155 L     ( a line of padding, so that the source spans several blocks )
+156 L     ( a line of padding, so that the source spans several blocks )
+157 L     ( a line of padding, so that the source spans several blocks )
+158 L     ( a line of padding, so that the source spans several blocks )
+159 L     ( a line of padding, so that the source spans several blocks )
+160 L     ( a line of padding, so that the source spans several blocks )
+LINES @ 160 <> ABORT" streamtest: lines missing at the end"
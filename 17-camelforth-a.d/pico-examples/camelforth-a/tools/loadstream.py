@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+loadstream.py: send Forth source to CamelForth with LOAD-STREAM,
+or a compiled dictionary segment with LOAD-IMAGE.
+
+  usage: loadstream.py [-p PORT] [-b BAUD] [-t SECS] file.fs ...
+         loadstream.py [-p PORT] ... --image file.img
+         loadstream.py --exec PROGRAM ...
+
+PORT is the board's serial device (default /dev/ttyACM0, the USB
+port; the UART is e.g. /dev/ttyUSB0).  --exec runs PROGRAM instead,
+talking to it on its stdin and stdout: with the host build,
+  loadstream.py --exec ./build-host/camelforth app.fs
+is a loopback test of the whole protocol without a board.
+
+The files are sent as one stream, with their line ends made LF.
+The board asks for each block with ACK; the sender answers with
+whole lines, at most the block size the board reports, and ETB,
+then EOT after the last.  The board's output is copied to stdout.
+An error on the board (CAN) is reported with the file and line,
+and the exit status is 1.  See forth/stream.inc.
+
+With --image the file is a segment made by host/forthimage: its
+header is sent at the first ACK and the rest at the second.  See
+forth/segment.inc.
+"""
+
+import argparse
+import os
+import re
+import select
+import subprocess
+import sys
+import termios
+import time
+import tty
+
+EOT, ACK, ETB, CAN = 0x04, 0x06, 0x17, 0x18
+SEGMENTHEADER = 6 * 4           # struct SegmentHeader, 32 bit cells
+
+
+class Port:
+    """a serial device, raw"""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attr = termios.tcgetattr(self.fd)
+        speed = getattr(termios, "B%d" % baud)
+        attr[4] = attr[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attr)
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.rfd = self.wfd = self.fd
+
+    def close(self):
+        os.close(self.fd)
+
+
+class Program:
+    """a program on stdin and stdout, e.g. the host build"""
+
+    def __init__(self, command):
+        self.proc = subprocess.Popen(command, shell=True, bufsize=0,
+                stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.rfd = self.proc.stdout.fileno()
+        self.wfd = self.proc.stdin.fileno()
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+def readsource(names):
+    """the lines of the files, and (file, line) for each"""
+    lines, where = [], []
+    for name in names:
+        with open(name, "rb") as f:
+            text = f.read().replace(b"\r\n", b"\n").replace(b"\r", b"\n")
+        if bytes([EOT]) in text or bytes([ETB]) in text:
+            sys.exit("%s: contains EOT or ETB" % name)
+        parts = text.split(b"\n")
+        if parts[-1] == b"":
+            parts.pop()
+        for n, line in enumerate(parts):
+            lines.append(line + b"\n")
+            where.append((name, n + 1))
+    return lines, where
+
+
+def blocks(lines, size):
+    """whole lines, up to size bytes at a time"""
+    block = b""
+    for line in lines:
+        if len(line) > size:
+            sys.exit("line longer than a block (%d bytes): %r" % (size, line))
+        if len(block) + len(line) > size:
+            yield block
+            block = b""
+        block += line
+    if block:
+        yield block
+
+
+def streamanswers(lines):
+    """what to send at each ACK of LOAD-STREAM, given the board's output"""
+    pending = None
+    def answer(text):
+        nonlocal pending
+        if pending is None:
+            m = re.search(rb"(\d+) bytes a block", text)
+            pending = blocks(lines, int(m.group(1)) if m else 1024)
+        block = next(pending, None)
+        return bytes([EOT]) if block is None else block + bytes([ETB])
+    return answer
+
+
+def imageanswers(image):
+    """what to send at each ACK of LOAD-IMAGE: the header, then the rest"""
+    parts = [image[:SEGMENTHEADER], image[SEGMENTHEADER:]]
+    return lambda text: parts.pop(0) if parts else b""
+
+
+def main():
+    ap = argparse.ArgumentParser(
+            description="send Forth source with LOAD-STREAM, or a segment with LOAD-IMAGE")
+    ap.add_argument("-p", "--port", default="/dev/ttyACM0")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("-t", "--timeout", type=float, default=10.0,
+                    help="seconds to wait for the board")
+    ap.add_argument("--exec", dest="program", help="run PROGRAM instead of a port")
+    ap.add_argument("--image", help="a segment made by forthimage")
+    ap.add_argument("files", nargs="*")
+    args = ap.parse_args()
+    if bool(args.image) == bool(args.files):
+        ap.error("give source files, or --image")
+
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+        lines, where = [], []
+        answer = imageanswers(image)
+        command = b"LOAD-IMAGE\n"
+    else:
+        lines, where = readsource(args.files)
+        answer = streamanswers(lines)
+        command = b"LOAD-STREAM\n"
+    link = Program(args.program) if args.program else Port(args.port, args.baud)
+    out = sys.stdout.buffer
+    text = b""                  # board output since the last ACK
+    start = time.time()
+    status = 0
+
+    os.write(link.wfd, command)
+    while True:
+        ready, _, _ = select.select([link.rfd], [], [], args.timeout)
+        if not ready:
+            sys.exit("\nno answer from the board in %g s" % args.timeout)
+        data = os.read(link.rfd, 4096)
+        if not data:
+            sys.exit("\nthe board went away")
+        for c in data:
+            if c == ACK:
+                os.write(link.wfd, answer(text))
+                text = b""
+            elif c == CAN:
+                m = re.search(rb"error in line (\d+)", text)
+                if m and 0 < int(m.group(1)) <= len(where):
+                    name, n = where[int(m.group(1)) - 1]
+                    sys.stderr.write("%s:%d: %s\n" % (name, n,
+                            lines[int(m.group(1)) - 1].decode(errors="replace").rstrip()))
+                status = 1
+                break
+            elif c == EOT:
+                break
+            else:
+                out.write(bytes([c]))
+                text += bytes([c])
+        else:
+            out.flush()
+            continue
+        break
+    out.flush()
+    link.close()
+    if args.image:
+        sys.stderr.write("%d bytes sent in %.2f s\n" % (len(image), time.time() - start))
+    else:
+        sys.stderr.write("%d lines sent in %.2f s\n" % (len(lines), time.time() - start))
+    sys.exit(status)
+
+
+if __name__ == "__main__":
+    main()